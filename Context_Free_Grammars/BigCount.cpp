@@ -0,0 +1,160 @@
+#include "BigCount.h"
+#include <cassert>
+#include <cmath>
+
+BigCount::BigCount(unsigned long long value) : digits() {
+	while (value != 0) {
+		digits.push_back(static_cast<std::uint32_t>(value));
+		value >>= 32;
+	}
+}
+
+void BigCount::trim() {
+	while (!digits.empty() && digits.back() == 0)
+		digits.pop_back();
+}
+
+unsigned BigCount::bitLength() const {
+	if (digits.empty())
+		return 0;
+	unsigned bits = static_cast<unsigned>(digits.size() - 1) * 32;
+	for (std::uint32_t top = digits.back(); top != 0; top >>= 1)
+		bits++;
+	return bits;
+}
+
+//Top three digits give at least 64 significant bits, more than a double keeps
+double BigCount::approximate(int& exponent) const {
+	exponent = 0;
+	if (digits.empty())
+		return 0.0;
+	double value = 0.0;
+	size_t lowest = digits.size() >= 3 ? digits.size() - 3 : 0;
+	for (size_t i = digits.size(); i-- > lowest;)
+		value = value * 4294967296.0 + digits[i];
+	double mantissa = std::frexp(value, &exponent);
+	exponent += static_cast<int>(lowest * 32);
+	return mantissa;
+}
+
+std::uint64_t BigCount::bitsAbove(unsigned shift) const {
+	auto digit = [this](size_t i) -> std::uint64_t { return i < digits.size() ? digits[i] : 0; };
+	const size_t first = shift / 32;
+	const unsigned rest = shift % 32;
+	std::uint64_t value = (digit(first) | digit(first + 1) << 32) >> rest;
+	if (rest != 0)
+		value |= digit(first + 2) << (64 - rest);
+	return value;
+}
+
+BigCount BigCount::randomBits(unsigned bits, std::mt19937_64& engine) {
+	BigCount result;
+	result.digits.resize((bits + 31) / 32);
+	for (std::uint32_t& digit : result.digits)
+		digit = static_cast<std::uint32_t>(engine());
+	if (bits % 32 != 0)
+		result.digits.back() &= (std::uint32_t(1) << (bits % 32)) - 1;
+	result.trim();
+	return result;
+}
+
+BigCount& BigCount::operator+=(const BigCount& other) {
+	if (digits.size() < other.digits.size())
+		digits.resize(other.digits.size(), 0);
+	std::uint64_t carry = 0;
+	for (size_t i = 0; i < digits.size(); i++) {
+		std::uint64_t sum = carry + digits[i] + (i < other.digits.size() ? other.digits[i] : 0);
+		digits[i] = static_cast<std::uint32_t>(sum);
+		carry = sum >> 32;
+		if (carry == 0 && i >= other.digits.size())
+			break;
+	}
+	if (carry != 0)
+		digits.push_back(static_cast<std::uint32_t>(carry));
+	return *this;
+}
+
+BigCount& BigCount::operator-=(const BigCount& other) {
+	assert(!(*this < other));
+	std::int64_t borrow = 0;
+	for (size_t i = 0; i < digits.size(); i++) {
+		std::int64_t difference = static_cast<std::int64_t>(digits[i]) - (i < other.digits.size() ? other.digits[i] : 0) - borrow;
+		borrow = difference < 0 ? 1 : 0;
+		digits[i] = static_cast<std::uint32_t>(difference + (borrow << 32));
+		if (borrow == 0 && i >= other.digits.size())
+			break;
+	}
+	trim();
+	return *this;
+}
+
+BigCount& BigCount::operator<<=(unsigned shift) {
+	if (digits.empty())
+		return *this;
+	digits.insert(digits.begin(), shift / 32, 0);
+	if (shift % 32 != 0) {
+		std::uint32_t carry = 0;
+		for (size_t i = shift / 32; i < digits.size(); i++) {
+			std::uint32_t digit = digits[i];
+			digits[i] = (digit << (shift % 32)) | carry;
+			carry = digit >> (32 - shift % 32);
+		}
+		if (carry != 0)
+			digits.push_back(carry);
+	}
+	return *this;
+}
+
+//Schoolbook multiplication, counts stay small enough that nothing faster pays off
+BigCount BigCount::operator*(const BigCount& other) const {
+	BigCount product;
+	if (isZero() || other.isZero())
+		return product;
+	product.digits.assign(digits.size() + other.digits.size(), 0);
+	for (size_t i = 0; i < digits.size(); i++) {
+		std::uint64_t carry = 0;
+		for (size_t j = 0; j < other.digits.size(); j++) {
+			std::uint64_t current = product.digits[i + j] + static_cast<std::uint64_t>(digits[i]) * other.digits[j] + carry;
+			product.digits[i + j] = static_cast<std::uint32_t>(current);
+			carry = current >> 32;
+		}
+		product.digits[i + other.digits.size()] = static_cast<std::uint32_t>(carry);
+	}
+	product.trim();
+	return product;
+}
+
+bool BigCount::operator<(const BigCount& other) const {
+	if (digits.size() != other.digits.size())
+		return digits.size() < other.digits.size();
+	for (size_t i = digits.size(); i-- > 0;) {
+		if (digits[i] != other.digits[i])
+			return digits[i] < other.digits[i];
+	}
+	return false;
+}
+
+//Repeated division by 10^9 gives nine decimal digits at a time, lowest first
+std::string BigCount::toString() const {
+	if (isZero())
+		return "0";
+	std::vector<std::uint32_t> rest = digits;
+	std::vector<std::uint32_t> groups;
+	while (!rest.empty()) {
+		std::uint64_t remainder = 0;
+		for (size_t i = rest.size(); i-- > 0;) {
+			std::uint64_t current = (remainder << 32) | rest[i];
+			rest[i] = static_cast<std::uint32_t>(current / 1000000000u);
+			remainder = current % 1000000000u;
+		}
+		groups.push_back(static_cast<std::uint32_t>(remainder));
+		while (!rest.empty() && rest.back() == 0)
+			rest.pop_back();
+	}
+	std::string result = std::to_string(groups.back());
+	for (size_t i = groups.size() - 1; i-- > 0;) {
+		std::string group = std::to_string(groups[i]);
+		result += std::string(9 - group.size(), '0') + group;
+	}
+	return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+//Unsigned integer of any size, for counting derivations exactly. Stored as base 2^32 digits, lowest first, without leading zeros.
+class BigCount {
+private:
+	std::vector<std::uint32_t> digits;
+
+	void trim();
+public:
+	BigCount() : digits() {}
+	BigCount(unsigned long long value);
+
+	bool isZero() const { return digits.empty(); }
+	bool moreThanOne() const { return digits.size() > 1 || (digits.size() == 1 && digits[0] > 1); }
+
+	//Number of bits without leading zeros, 0 for 0
+	unsigned bitLength() const;
+	//Returns m in [0.5, 1) and sets exponent so that the value is about m * 2^exponent. Returns 0 for 0.
+	double approximate(int& exponent) const;
+	//Bits from shift up as a 64-bit number; higher bits have to be 0
+	std::uint64_t bitsAbove(unsigned shift) const;
+	//Uniformly random number in [0, 2^bits)
+	static BigCount randomBits(unsigned bits, std::mt19937_64& engine);
+
+	BigCount& operator += (const BigCount& other);
+	//other must not be bigger than this
+	BigCount& operator -= (const BigCount& other);
+	BigCount& operator <<= (unsigned shift);
+	BigCount operator * (const BigCount& other) const;
+	bool operator < (const BigCount& other) const;
+	bool operator == (const BigCount& other) const { return digits == other.digits; }
+
+	std::string toString() const;
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//Word-wide kernels over fixed-width bitsets of non-terminals. A bitset of N non-terminals is stored as
+//bitsetWords(N) consecutive 64-bit words. AVX2 is used when the compiler targets it (/arch:AVX2 or -mavx2),
+//otherwise the scalar loops do all the work.
+
+using bitWord = std::uint64_t;
+
+const unsigned BITS_PER_WORD = 64;
+
+inline unsigned bitsetWords(unsigned bits) {
+	return (bits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+//Triangular charts over a word of n letters keep one cell per span, rows of spans of equal length shortest first.
+//Span of len letters (1..n) starting at i; rows below it hold (len - 1) * n - (len - 1) * (len - 2) / 2 cells.
+inline std::size_t spanCell(unsigned n, unsigned i, unsigned len) {
+	std::size_t below = len - 1;
+	return below * n - below * (below - 1) / 2 + i;
+}
+
+inline std::size_t spanCellCount(unsigned n) {
+	return static_cast<std::size_t>(n) * (n + 1) / 2;
+}
+
+inline void setBit(bitWord* set, unsigned bit) {
+	set[bit / BITS_PER_WORD] |= bitWord(1) << (bit % BITS_PER_WORD);
+}
+
+inline bool testBit(const bitWord* set, unsigned bit) {
+	return (set[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1;
+}
+
+//Index of lowest set bit. word must not be 0.
+inline unsigned lowestBit(bitWord word) {
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, static_cast<unsigned long>(word)))
+		return index;
+	_BitScanForward(&index, static_cast<unsigned long>(word >> 32));
+	return index + 32;
+#else
+	return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
+
+//dst |= src
+inline void orInto(bitWord* dst, const bitWord* src, unsigned words) {
+	unsigned w = 0;
+#if defined(__AVX2__)
+	for (; w + 4 <= words; w += 4) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + w));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), _mm256_or_si256(a, b));
+	}
+#endif
+	for (; w < words; w++)
+		dst[w] |= src[w];
+}
+
+//Returns whether (a & b) has any bit set
+inline bool intersects(const bitWord* a, const bitWord* b, unsigned words) {
+	unsigned w = 0;
+#if defined(__AVX2__)
+	for (; w + 4 <= words; w += 4) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + w));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w));
+		if (!_mm256_testz_si256(x, y))
+			return true;
+	}
+#endif
+	for (; w < words; w++) {
+		if (a[w] & b[w])
+			return true;
+	}
+	return false;
+}
+
+inline bool anyBit(const bitWord* set, unsigned words) {
+	for (unsigned w = 0; w < words; w++) {
+		if (set[w])
+			return true;
+	}
+	return false;
+}
+
+//Calls f(bit) for every set bit in ascending order
+template <typename F>
+inline void forEachBit(const bitWord* set, unsigned words, F f) {
+	for (unsigned w = 0; w < words; w++) {
+		bitWord word = set[w];
+		while (word) {
+			f(w * BITS_PER_WORD + lowestBit(word));
+			word &= word - 1;
+		}
+	}
+}
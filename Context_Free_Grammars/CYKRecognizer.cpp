@@ -0,0 +1,154 @@
+#include "CYKRecognizer.h"
+#include <algorithm>
+
+CYKRecognizer::CYKRecognizer(const RuleStore& rules, unsigned nonTerminalCount, symbol startSymbol) :
+	ntCount(nonTerminalCount), words(bitsetWords(nonTerminalCount)), startSymbol(startSymbol), acceptsEmpty(false),
+	terminalHeads(256 * static_cast<size_t>(bitsetWords(nonTerminalCount)), 0), secondMask(static_cast<size_t>(nonTerminalCount) * bitsetWords(nonTerminalCount), 0),
+	pairOffsets(nonTerminalCount + 1, 0) {
+
+	//Sort binary rules by (B, C) so that every pair gets one entry
+	std::vector<std::pair<std::pair<symbol, symbol>, symbol> > binary; //((B, C), A)
+	for (const auto& rule : rules) {
+		if (rule.product.size() == 1 && isTerminalSymbol(rule.product[0])) {
+			if (rule.product[0] == EPSILON_SYMBOL)
+				acceptsEmpty = acceptsEmpty || rule.nonTerminal == startSymbol;
+			else
+				setBit(&terminalHeads[static_cast<unsigned char>(terminalOf(rule.product[0])) * static_cast<size_t>(words)], rule.nonTerminal);
+		}
+		else if (rule.product.size() == 2) {
+			binary.push_back({ { rule.product[0], rule.product[1] }, rule.nonTerminal });
+		}
+	}
+	std::sort(binary.begin(), binary.end());
+
+	for (size_t r = 0; r < binary.size(); r++) {
+		symbol B = binary[r].first.first;
+		symbol C = binary[r].first.second;
+		if (r == 0 || binary[r - 1].first != binary[r].first) {
+			pairSecond.push_back(C);
+			pairHeads.resize(pairHeads.size() + words, 0);
+			pairOffsets[B + 1]++;
+			setBit(&secondMask[B * static_cast<size_t>(words)], C);
+		}
+		setBit(&pairHeads[pairHeads.size() - words], binary[r].second);
+	}
+	for (unsigned B = 0; B < ntCount; B++)
+		pairOffsets[B + 1] += pairOffsets[B];
+}
+
+const bitWord* CYKRecognizer::cell(const std::vector<bitWord>& chart, unsigned n, unsigned i, unsigned len) const {
+	return &chart[spanCell(n, i, len + 1) * words];
+}
+
+bitWord* CYKRecognizer::cell(std::vector<bitWord>& chart, unsigned n, unsigned i, unsigned len) const {
+	return &chart[spanCell(n, i, len + 1) * words];
+}
+
+size_t CYKRecognizer::memoryBytes() const {
+	return sizeof(*this) + heapBytes(terminalHeads) + heapBytes(secondMask) + heapBytes(pairOffsets) + heapBytes(pairSecond) + heapBytes(pairHeads);
+}
+
+size_t CYKRecognizer::chartSize(unsigned n) const {
+	return spanCellCount(n) * words;
+}
+
+bool CYKRecognizer::fillLetters(std::vector<bitWord>& chart, const char* word, unsigned n) const {
+	bool allKnown = true;
+	for (unsigned i = 0; i < n; i++) {
+		const bitWord* heads = letterHeads(word[i]);
+		std::copy(heads, heads + words, cell(chart, n, i, 0));
+		allKnown = allKnown && anyBit(heads, words);
+	}
+	return allKnown;
+}
+
+void CYKRecognizer::combine(bitWord* target, const bitWord* left, const bitWord* right) const {
+	if (!anyBit(right, words))
+		return;
+	forEachBit(left, words, [&](unsigned B) {
+		if (!intersects(&secondMask[B * static_cast<size_t>(words)], right, words))
+			return;
+		for (unsigned p = pairOffsets[B]; p < pairOffsets[B + 1]; p++) {
+			if (testBit(right, pairSecond[p]))
+				orInto(target, &pairHeads[p * static_cast<size_t>(words)], words);
+		}
+	});
+}
+
+void CYKRecognizer::fillCell(std::vector<bitWord>& chart, unsigned n, unsigned i, unsigned len) const {
+	bitWord* target = cell(chart, n, i, len);
+	std::fill(target, target + words, 0);
+	for (unsigned k = 0; k < len; k++) { //left part is [i, i + k], right part is [i + k + 1, i + len]
+		combine(target, cell(chart, n, i, k), cell(chart, n, i + k + 1, len - k - 1));
+	}
+}
+
+bool CYKRecognizer::startInTop(const std::vector<bitWord>& chart, unsigned n) const {
+	return hasStart(cell(chart, n, 0, n - 1));
+}
+
+bool CYKRecognizer::recognize(const char* word, unsigned n, std::vector<bitWord>& chart) const {
+	if (n == 0)
+		return acceptsEmpty;
+	if (ntCount == 0)
+		return false;
+	chart.assign(chartSize(n), 0);
+	if (!fillLetters(chart, word, n))
+		return false;
+	for (unsigned len = 1; len < n; len++) {
+		for (unsigned i = 0; i + len < n; i++)
+			fillCell(chart, n, i, len);
+	}
+	return startInTop(chart, n);
+}
+
+void CYKRecognizer::fillChart(const char* word, unsigned n, std::vector<bitWord>& chart) const {
+	chart.assign(chartSize(n), 0);
+	if (ntCount == 0)
+		return;
+	fillLetters(chart, word, n);
+	for (unsigned len = 1; len < n; len++) {
+		for (unsigned i = 0; i + len < n; i++)
+			fillCell(chart, n, i, len);
+	}
+}
+
+bool CYKRecognizer::recognize(const std::string& word) const {
+	std::vector<bitWord> chart;
+	return recognize(word.data(), static_cast<unsigned>(word.length()), chart);
+}
+
+bool CYKRecognizer::recognize(const char* word, unsigned n, std::vector<bitWord>& chart, ThreadPool& pool) const {
+	if (pool.size() == 1 || n < PARALLEL_CYK_MIN_LENGTH)
+		return recognize(word, n, chart);
+	if (ntCount == 0)
+		return false;
+	chart.assign(chartSize(n), 0);
+	if (!fillLetters(chart, word, n))
+		return false;
+	fillRows(chart, n, pool);
+	return startInTop(chart, n);
+}
+
+void CYKRecognizer::fillChart(const char* word, unsigned n, std::vector<bitWord>& chart, ThreadPool& pool) const {
+	if (pool.size() == 1 || n < PARALLEL_CYK_MIN_LENGTH) {
+		fillChart(word, n, chart);
+		return;
+	}
+	chart.assign(chartSize(n), 0);
+	if (ntCount == 0)
+		return;
+	fillLetters(chart, word, n);
+	fillRows(chart, n, pool);
+}
+
+void CYKRecognizer::fillRows(std::vector<bitWord>& chart, unsigned n, ThreadPool& pool) const {
+	for (unsigned len = 1; len < n; len++) {
+		size_t cells = n - len;
+		size_t grain = cells / (pool.size() * 4) + 1; //a few chunks per worker leave room for stealing since cells near the edges are cheaper
+		pool.parallelFor(0, cells, grain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				fillCell(chart, n, static_cast<unsigned>(i), len);
+		});
+	}
+}
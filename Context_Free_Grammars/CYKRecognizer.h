@@ -0,0 +1,68 @@
+#pragma once
+#include "BitKernel.h"
+#include "ProducitonRule.h"
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+
+//Words shorter than this are always recognized serially since spreading their few cells over threads costs more than it saves
+const unsigned PARALLEL_CYK_MIN_LENGTH = 96;
+
+//CYK engine over a grammar in Chomsky normal form.
+//The chart is triangular: row 'len' holds one cell for every start position of a span of length len+1.
+//Every cell is a fixed-width bitset of non-terminals. Rules A->BC are indexed by B: for every B there is a
+//mask of all C that follow it in some rule and a list of (C, heads) where heads is the bitset of all A with A->BC.
+class CYKRecognizer {
+private:
+	unsigned ntCount;
+	unsigned words;				//64-bit words per cell
+	symbol startSymbol;
+	bool acceptsEmpty;			//S->@ exists
+
+	std::vector<bitWord> terminalHeads;	//256 bitsets: terminalHeads[c] = {A | A->c}
+	std::vector<bitWord> secondMask;	//ntCount bitsets: secondMask[B] = {C | A->BC}
+	std::vector<unsigned> pairOffsets;	//pairs of B are [pairOffsets[B], pairOffsets[B + 1])
+	std::vector<symbol> pairSecond;		//C of pair
+	std::vector<bitWord> pairHeads;		//bitset of heads of pair
+
+	const bitWord* cell(const std::vector<bitWord>& chart, unsigned n, unsigned i, unsigned len) const;
+	bitWord* cell(std::vector<bitWord>& chart, unsigned n, unsigned i, unsigned len) const;
+	//Fills rows 1..n-1 of chart whose first row is filled, every row in parallel on pool with a barrier between rows
+	void fillRows(std::vector<bitWord>& chart, unsigned n, ThreadPool& pool) const;
+public:
+	CYKRecognizer(const RuleStore& rules, unsigned nonTerminalCount, symbol startSymbol);
+
+	unsigned cellWords() const { return words; }
+	//Bytes of the rule index, which grows with the square of the number of non-terminals
+	size_t memoryBytes() const;
+	bool emptyWordAccepted() const { return acceptsEmpty; }
+	//Bitset of all A with A->c
+	const bitWord* letterHeads(char c) const { return &terminalHeads[static_cast<unsigned char>(c) * static_cast<size_t>(words)]; }
+	bool hasStart(const bitWord* cell) const { return startSymbol < ntCount && testBit(cell, startSymbol); }
+	//target |= {A | A->BC, B in left, C in right}
+	void combine(bitWord* target, const bitWord* left, const bitWord* right) const;
+	//Number of words in chart for word of length n
+	size_t chartSize(unsigned n) const;
+
+	//Fills first row of chart. Returns false if some letter has no non-terminal, i.e. word cannot be recognized.
+	bool fillLetters(std::vector<bitWord>& chart, const char* word, unsigned n) const;
+	//Fills cell for span [i, i + len] (row len) from rows below it
+	void fillCell(std::vector<bitWord>& chart, unsigned n, unsigned i, unsigned len) const;
+	bool startInTop(const std::vector<bitWord>& chart, unsigned n) const;
+	//Fills whole chart even if some letter has no non-terminal, so every span can be read with startDerives
+	void fillChart(const char* word, unsigned n, std::vector<bitWord>& chart) const;
+	//Same as fillChart, with rows filled in parallel on pool as in recognize
+	void fillChart(const char* word, unsigned n, std::vector<bitWord>& chart, ThreadPool& pool) const;
+	//Whether starting symbol derives span [i, i + len] (row len) of a filled chart
+	bool startDerives(const std::vector<bitWord>& chart, unsigned n, unsigned i, unsigned len) const { return hasStart(cell(chart, n, i, len)); }
+	//Whether nt derives span [i, i + len] (row len) of a filled chart
+	bool derives(const std::vector<bitWord>& chart, unsigned n, unsigned i, unsigned len, symbol nt) const {
+		return nt < ntCount && testBit(cell(chart, n, i, len), nt);
+	}
+
+	//chart is a reusable buffer, resized as needed
+	bool recognize(const char* word, unsigned n, std::vector<bitWord>& chart) const;
+	bool recognize(const std::string& word) const;
+	//Fills every row (anti-diagonal of span lengths) in parallel on pool with a barrier between rows
+	bool recognize(const char* word, unsigned n, std::vector<bitWord>& chart, ThreadPool& pool) const;
+};
@@ -0,0 +1,68 @@
+#include "CYKSession.h"
+#include <algorithm>
+#include <numeric>
+
+CYKSession::CYKSession(std::shared_ptr<const CYKRecognizer> recognizer) : recognizer(recognizer), prefix(), columns() {}
+
+//Columns 0..e-1 hold 1 + 2 + ... + e cells
+size_t CYKSession::columnOffset(unsigned e) const {
+	return static_cast<size_t>(e) * (e + 1) / 2 * recognizer->cellWords();
+}
+
+bitWord* CYKSession::cell(unsigned s, unsigned e) {
+	return &columns[columnOffset(e) + static_cast<size_t>(s) * recognizer->cellWords()];
+}
+
+void CYKSession::append(char letter) {
+	const unsigned e = static_cast<unsigned>(prefix.length());
+	const unsigned words = recognizer->cellWords();
+	prefix.push_back(letter);
+	columns.resize(columnOffset(e + 1), 0);
+
+	const bitWord* heads = recognizer->letterHeads(letter);
+	std::copy(heads, heads + words, cell(e, e));
+	//Cell [s, e] is split in [s, k] from an older column and [k + 1, e] which is computed earlier in this column
+	for (unsigned s = e; s-- > 0;) {
+		bitWord* target = cell(s, e);
+		std::fill(target, target + words, 0);
+		for (unsigned k = s; k < e; k++)
+			recognizer->combine(target, cell(s, k), cell(k + 1, e));
+	}
+}
+
+void CYKSession::append(const std::string& letters) {
+	for (char letter : letters)
+		append(letter);
+}
+
+void CYKSession::truncate(unsigned length) {
+	if (length >= prefix.length())
+		return;
+	prefix.resize(length);
+	columns.resize(columnOffset(length));
+}
+
+bool CYKSession::accepted() const {
+	if (prefix.empty())
+		return recognizer->emptyWordAccepted();
+	const unsigned e = static_cast<unsigned>(prefix.length()) - 1;
+	return recognizer->hasStart(&columns[columnOffset(e)]); //cell [0, e] is first of last column
+}
+
+std::vector<bool> CYKSession::recognizeAll(const std::vector<std::string>& words) {
+	std::vector<size_t> order(words.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return words[a] < words[b]; });
+
+	std::vector<bool> result(words.size(), false);
+	for (size_t index : order) {
+		const std::string& word = words[index];
+		unsigned common = 0;
+		while (common < prefix.length() && common < word.length() && prefix[common] == word[common])
+			common++;
+		truncate(common);
+		append(word.substr(common));
+		result[index] = accepted();
+	}
+	return result;
+}
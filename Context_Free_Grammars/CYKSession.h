@@ -0,0 +1,35 @@
+#pragma once
+#include "CYKRecognizer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+//Incremental CYK over a word which grows one letter at a time.
+//Chart is kept by columns: column e holds cells [s, e] for every start s <= e. Appending a letter only computes the new column,
+//which is O(n^2) work instead of rebuilding the whole O(n^3) chart. Truncating drops columns, so words which share a prefix
+//can reuse the columns of that prefix.
+class CYKSession {
+private:
+	std::shared_ptr<const CYKRecognizer> recognizer;
+	std::string prefix;
+	std::vector<bitWord> columns;
+
+	size_t columnOffset(unsigned e) const;
+	bitWord* cell(unsigned s, unsigned e);
+public:
+	explicit CYKSession(std::shared_ptr<const CYKRecognizer> recognizer);
+
+	void append(char letter);
+	void append(const std::string& letters);
+	//Keeps only first length letters and their columns
+	void truncate(unsigned length);
+	void clear() { truncate(0); }
+
+	//Whether current prefix is recognized
+	bool accepted() const;
+	const std::string& word() const { return prefix; }
+
+	//Recognizes every word. Words are visited in sorted order and every one of them reuses the columns of
+	//its longest common prefix with the previous one. Results are in the order of words.
+	std::vector<bool> recognizeAll(const std::vector<std::string>& words);
+};
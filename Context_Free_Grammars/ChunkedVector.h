@@ -0,0 +1,192 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Bytes of memory held by an object. Parts which are shared with copies of the object are counted separately.
+struct MemoryUsage {
+	size_t owned;
+	size_t shared;
+
+	MemoryUsage() : owned(0), shared(0) {}
+	void add(size_t bytes, bool isShared) { (isShared ? shared : owned) += bytes; }
+	void add(const MemoryUsage& other) { owned += other.owned; shared += other.shared; }
+};
+
+inline size_t heapBytes(const std::string& s) {
+	return s.capacity() > sizeof(std::string) ? s.capacity() + 1 : 0; //short strings are kept inside the object
+}
+
+template <typename T>
+inline size_t heapBytes(const std::vector<T>& v) {
+	return v.capacity() * sizeof(T);
+}
+
+inline size_t heapBytes(const std::vector<bool>& v) {
+	return v.capacity() / 8;
+}
+
+//Sequence kept in chunks of at most CHUNK_SIZE elements which copies share (copy-on-write). Copying the sequence only copies pointers to chunks;
+//a chunk is copied the first time a sequence changes it while another sequence still uses it. Every chunk except the last one
+//is full, so an element is found in O(1).
+template <typename T>
+class ChunkedVector {
+private:
+	static const size_t CHUNK_SIZE = 1024;
+	static const size_t MIN_CHUNK_CAPACITY = 8;
+	using Chunk = std::vector<T>;
+
+	std::vector<std::shared_ptr<Chunk> > chunks;
+	size_t count;
+
+	Chunk& writableChunk(size_t c) {
+		if (chunks[c].use_count() > 1)
+			chunks[c] = std::make_shared<Chunk>(*chunks[c]);
+		return *chunks[c];
+	}
+
+	//Element at index i, moved out if no other sequence uses its chunk
+	T take(size_t i) {
+		size_t c = i / CHUNK_SIZE;
+		if (chunks[c].use_count() > 1)
+			return (*chunks[c])[i % CHUNK_SIZE];
+		return std::move((*chunks[c])[i % CHUNK_SIZE]);
+	}
+
+	void truncate(size_t length) {
+		chunks.resize((length + CHUNK_SIZE - 1) / CHUNK_SIZE);
+		if (length % CHUNK_SIZE != 0)
+			writableChunk(chunks.size() - 1).resize(length % CHUNK_SIZE);
+		count = length;
+	}
+public:
+	class const_iterator {
+	private:
+		const ChunkedVector* owner;
+		size_t index;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		const_iterator() : owner(nullptr), index(0) {}
+		const_iterator(const ChunkedVector* owner, size_t index) : owner(owner), index(index) {}
+
+		reference operator*() const { return (*owner)[index]; }
+		pointer operator->() const { return &(*owner)[index]; }
+		reference operator[](difference_type n) const { return (*owner)[index + n]; }
+		const_iterator& operator++() { index++; return *this; }
+		const_iterator operator++(int) { const_iterator old = *this; index++; return old; }
+		const_iterator& operator--() { index--; return *this; }
+		const_iterator operator--(int) { const_iterator old = *this; index--; return old; }
+		const_iterator& operator+=(difference_type n) { index += n; return *this; }
+		const_iterator& operator-=(difference_type n) { index -= n; return *this; }
+		const_iterator operator+(difference_type n) const { return const_iterator(owner, index + n); }
+		const_iterator operator-(difference_type n) const { return const_iterator(owner, index - n); }
+		difference_type operator-(const const_iterator& other) const { return static_cast<difference_type>(index) - static_cast<difference_type>(other.index); }
+		bool operator==(const const_iterator& other) const { return index == other.index; }
+		bool operator!=(const const_iterator& other) const { return index != other.index; }
+		bool operator<(const const_iterator& other) const { return index < other.index; }
+	};
+
+	ChunkedVector() : chunks(), count(0) {}
+	ChunkedVector(const ChunkedVector& other) = default;
+	ChunkedVector(ChunkedVector&& other) noexcept : chunks(std::move(other.chunks)), count(other.count) {
+		other.chunks.clear();
+		other.count = 0;
+	}
+	ChunkedVector& operator = (const ChunkedVector& other) = default;
+	ChunkedVector& operator = (ChunkedVector&& other) noexcept {
+		if (this != &other) {
+			chunks = std::move(other.chunks);
+			count = other.count;
+			other.chunks.clear();
+			other.count = 0;
+		}
+		return *this;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const T& operator[](size_t i) const { return (*chunks[i / CHUNK_SIZE])[i % CHUNK_SIZE]; }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, count); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+	//Reference through which element at index i can be changed. Its chunk stops being shared.
+	T& modify(size_t i) { return writableChunk(i / CHUNK_SIZE)[i % CHUNK_SIZE]; }
+
+	//Last chunk grows by doubling up to CHUNK_SIZE, so a small sequence does not hold a whole chunk
+	void push_back(T value) {
+		if (chunks.empty() || chunks.back()->size() == CHUNK_SIZE)
+			chunks.push_back(std::make_shared<Chunk>());
+		Chunk& last = writableChunk(chunks.size() - 1);
+		if (last.size() == last.capacity()) {
+			size_t capacity = last.size() < MIN_CHUNK_CAPACITY ? MIN_CHUNK_CAPACITY : 2 * last.size();
+			last.reserve(capacity < CHUNK_SIZE ? capacity : CHUNK_SIZE);
+		}
+		last.push_back(std::move(value));
+		count++;
+	}
+
+	//Only the table of chunks is reserved, chunks grow as elements are added
+	void reserve(size_t capacity) { chunks.reserve((capacity + CHUNK_SIZE - 1) / CHUNK_SIZE); }
+
+	void clear() {
+		chunks.clear();
+		count = 0;
+	}
+
+	void assign(std::vector<T>&& values) {
+		clear();
+		for (auto& value : values)
+			push_back(std::move(value));
+	}
+
+	//Removes every element for which remove returns true, keeping order of the others.
+	//Chunks before the first removed element stay shared.
+	template <typename Predicate>
+	void removeIf(Predicate remove) {
+		size_t first = 0;
+		while (first < count && !remove((*this)[first]))
+			first++;
+		if (first == count)
+			return;
+		std::vector<T> kept;
+		for (size_t i = first + 1; i < count; i++) {
+			if (!remove((*this)[i]))
+				kept.push_back(take(i));
+		}
+		truncate(first);
+		for (auto& value : kept)
+			push_back(std::move(value));
+	}
+
+	void erase(size_t index) {
+		std::vector<T> kept;
+		for (size_t i = index + 1; i < count; i++)
+			kept.push_back(take(i));
+		truncate(index);
+		for (auto& value : kept)
+			push_back(std::move(value));
+	}
+
+	//elementBytes(e) gives memory e holds outside of the chunk
+	template <typename HeapBytes>
+	MemoryUsage memoryUsage(HeapBytes elementBytes) const {
+		MemoryUsage usage;
+		usage.add(sizeof(*this) + chunks.capacity() * sizeof(std::shared_ptr<Chunk>), false);
+		for (const auto& chunk : chunks) {
+			size_t bytes = sizeof(Chunk) + chunk->capacity() * sizeof(T);
+			for (const T& element : *chunk)
+				bytes += elementBytes(element);
+			usage.add(bytes, chunk.use_count() > 1);
+		}
+		return usage;
+	}
+};
@@ -0,0 +1,184 @@
+#include "CommandParser.h"
+#include <climits>
+
+static bool isSmallLetterOrDigit(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+}
+
+static bool isRuleCharacter(char c) {
+	return isSmallLetterOrDigit(c) || (c >= 'A' && c <= 'Z') || c == '_' || c == '-' || c == '>' || c == ' ' || c == '.';
+}
+
+static bool isPathCharacter(char c) {
+	return c != '"' && c != '\t' && c != '\n' && c != '\v' && c != '\f' && c != '\r';
+}
+
+//Reads [1-9]\d*|0. Numbers too big for unsigned become UINT_MAX, which is never a valid id or index.
+static bool parseNumber(const std::string& line, size_t& cursor, unsigned& number) {
+	size_t start = cursor;
+	unsigned long long value = 0;
+	while (cursor < line.size() && line[cursor] >= '0' && line[cursor] <= '9') {
+		if (value <= UINT_MAX)
+			value = value * 10 + (line[cursor] - '0');
+		cursor++;
+	}
+	if (cursor == start || (line[start] == '0' && cursor - start > 1))
+		return false;
+	number = value > UINT_MAX ? UINT_MAX : static_cast<unsigned>(value);
+	return true;
+}
+
+//Name of a required <name>=<n> argument, nullptr for kinds of other forms
+static const char* numberName(ArgumentKind kind) {
+	switch (kind) {
+	case ArgumentKind::ITERATIONS:
+		return "iterations";
+	case ArgumentKind::LENGTH:
+		return "length";
+	case ArgumentKind::COUNT:
+		return "count";
+	default:
+		return nullptr;
+	}
+}
+
+//Reads "..." where every character satisfies allowed. Empty quotes are not accepted.
+template <typename Predicate>
+static bool parseQuoted(const std::string& line, size_t& cursor, Predicate allowed, std::string& text) {
+	if (cursor >= line.size() || line[cursor] != '"')
+		return false;
+	size_t start = ++cursor;
+	while (cursor < line.size() && line[cursor] != '"') {
+		if (!allowed(line[cursor]))
+			return false;
+		cursor++;
+	}
+	if (cursor >= line.size() || cursor == start)
+		return false;
+	text.assign(line, start, cursor - start);
+	cursor++;
+	return true;
+}
+
+unsigned CommandParser::add(const std::string& keyword, const std::vector<ArgumentKind>& arguments) {
+	unsigned index = static_cast<unsigned>(commands.size());
+	commands.push_back({ keyword, arguments });
+	byKeyword.emplace(keyword, index);
+	return index;
+}
+
+bool CommandParser::parseArgument(ArgumentKind kind, const std::string& line, size_t& cursor, ParsedCommand& parsed) const {
+	if (kind == ArgumentKind::THREADS) { //optional, so missing argument is not an error
+		static const std::string prefix = " threads=";
+		if (line.compare(cursor, prefix.size(), prefix) != 0)
+			return true;
+		cursor += prefix.size();
+		return parseNumber(line, cursor, parsed.threads) && parsed.threads != 0;
+	}
+	if (kind == ArgumentKind::BEAM) {
+		static const std::string prefix = " beam=";
+		if (line.compare(cursor, prefix.size(), prefix) != 0)
+			return true;
+		cursor += prefix.size();
+		return parseNumber(line, cursor, parsed.beam) && parsed.beam != 0;
+	}
+	if (kind == ArgumentKind::SEED) {
+		static const std::string prefix = " seed=";
+		if (line.compare(cursor, prefix.size(), prefix) != 0)
+			return true;
+		cursor += prefix.size();
+		return parseNumber(line, cursor, parsed.seed) && parsed.seed != 0;
+	}
+	const char* name = numberName(kind);
+	if (name != nullptr) {
+		const std::string prefix = std::string(" ") + name + "=";
+		unsigned number;
+		if (line.compare(cursor, prefix.size(), prefix) != 0)
+			return false;
+		cursor += prefix.size();
+		if (!parseNumber(line, cursor, number) || (number == 0 && kind != ArgumentKind::LENGTH))
+			return false;
+		parsed.numbers.push_back(number);
+		return true;
+	}
+	if (cursor >= line.size() || line[cursor] != ' ')
+		return false;
+	cursor++;
+	std::string text;
+	unsigned number;
+	switch (kind) {
+	case ArgumentKind::GRAMMAR_ID:
+		if (!parseNumber(line, cursor, number))
+			return false;
+		parsed.ids.push_back(number);
+		return true;
+	case ArgumentKind::GRAMMAR_IDS: {
+		size_t first = parsed.ids.size();
+		while (true) {
+			if (!parseNumber(line, cursor, number))
+				return false;
+			parsed.ids.push_back(number);
+			if (cursor + 1 >= line.size() || line[cursor] != ' ' || line[cursor + 1] < '0' || line[cursor + 1] > '9')
+				return parsed.ids.size() - first >= 2;
+			cursor++;
+		}
+	}
+	case ArgumentKind::NUMBER:
+		if (!parseNumber(line, cursor, number))
+			return false;
+		parsed.numbers.push_back(number);
+		return true;
+	case ArgumentKind::PATH:
+		if (!parseQuoted(line, cursor, isPathCharacter, text))
+			return false;
+		break;
+	case ArgumentKind::RULE:
+		if (!parseQuoted(line, cursor, isRuleCharacter, text))
+			return false;
+		break;
+	case ArgumentKind::WORD:
+		if (!parseQuoted(line, cursor, isSmallLetterOrDigit, text))
+			return false;
+		break;
+	case ArgumentKind::WORDS:
+		while (true) {
+			if (!parseQuoted(line, cursor, isSmallLetterOrDigit, text))
+				return false;
+			parsed.texts.push_back(text);
+			if (line.compare(cursor, 2, " \"") != 0)
+				return true;
+			cursor++;
+		}
+	default:
+		return false;
+	}
+	parsed.texts.push_back(text);
+	return true;
+}
+
+bool CommandParser::parse(const std::string& line, ParsedCommand& parsed) const {
+	//Keyword is first word, or first two words for commands like "add rule"
+	size_t firstSpace = line.find(' ');
+	size_t cursor = firstSpace == std::string::npos ? line.size() : firstSpace;
+	auto found = byKeyword.find(line.substr(0, cursor));
+	if (found == byKeyword.end() && firstSpace != std::string::npos) {
+		size_t secondSpace = line.find(' ', firstSpace + 1);
+		cursor = secondSpace == std::string::npos ? line.size() : secondSpace;
+		found = byKeyword.find(line.substr(0, cursor));
+	}
+	if (found == byKeyword.end())
+		return false;
+
+	parsed.command = found->second;
+	parsed.ids.clear();
+	parsed.numbers.clear();
+	parsed.texts.clear();
+	parsed.threads = 0;
+	parsed.beam = 0;
+	parsed.seed = 0;
+	for (ArgumentKind kind : commands[found->second].arguments) {
+		if (!parseArgument(kind, line, cursor, parsed))
+			return false;
+	}
+	return cursor == line.size();
+}
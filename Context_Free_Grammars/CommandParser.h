@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Kinds of arguments a command can take. Every argument is preceded by exactly one space.
+enum class ArgumentKind {
+	GRAMMAR_ID,	//0 or number without leading zeros, id of a grammar which has to exist
+	GRAMMAR_IDS,	//two or more GRAMMAR_ID arguments
+	NUMBER,		//0 or number without leading zeros
+	PATH,		//"..." without other quotes and without whitespace other than spaces
+	RULE,		//"..." of letters, digits, '_', '-', '>', spaces and '.'
+	WORD,		//"..." of small letters and digits
+	WORDS,		//one or more WORD arguments
+	ITERATIONS,	//iterations=<n> with n > 0, stored with NUMBER arguments
+	LENGTH,		//length=<n>, stored with NUMBER arguments
+	COUNT,		//count=<n> with n > 0, stored with NUMBER arguments
+	THREADS,	//optional threads=<n> with n > 0
+	BEAM,		//optional beam=<n> with n > 0
+	SEED		//optional seed=<n> with n > 0
+};
+
+struct ParsedCommand {
+	unsigned command;			//index returned by CommandParser::add
+	std::vector<unsigned> ids;		//GRAMMAR_ID(S) arguments in order
+	std::vector<unsigned> numbers;		//NUMBER, ITERATIONS, LENGTH and COUNT arguments in order
+	std::vector<std::string> texts;		//PATH, RULE and WORD(S) arguments in order, without quotes
+	unsigned threads;			//0 if THREADS argument was not given
+	unsigned beam;				//0 if BEAM argument was not given
+	unsigned seed;				//0 if SEED argument was not given
+};
+
+//Hand-written replacement of one regular expression per command. A line is tokenized in a single pass: keyword is looked up
+//in a hash table and the arguments of the found command are read left to right. Commands are case and space sensitive and
+//nothing may follow the last argument, which the former unanchored expressions of open and save allowed.
+class CommandParser {
+private:
+	struct Command {
+		std::string keyword;
+		std::vector<ArgumentKind> arguments;
+	};
+
+	std::vector<Command> commands;
+	std::unordered_map<std::string, unsigned> byKeyword;
+
+	bool parseArgument(ArgumentKind kind, const std::string& line, size_t& cursor, ParsedCommand& parsed) const;
+public:
+	//Keyword may be two words, i.e. "add rule". Returns index of the command.
+	unsigned add(const std::string& keyword, const std::vector<ArgumentKind>& arguments);
+	//Returns false if line is not exactly one of the added commands
+	bool parse(const std::string& line, ParsedCommand& parsed) const;
+};
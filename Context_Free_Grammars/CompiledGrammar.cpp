@@ -0,0 +1,172 @@
+#include "CompiledGrammar.h"
+#include <algorithm>
+#include <cmath>
+
+//Marks every head whose rule has all product symbols accepted by 'known'. Every rule counts how many of its non-terminals
+//are not marked yet and a worklist decrements those counters, so the fixpoint costs O(|R| + total product length).
+template <typename Known>
+static std::vector<bool> markHeads(const RuleStore& rules, unsigned nonTerminalCount, Known knownTerminal) {
+	std::vector<bool> marked(nonTerminalCount, false);
+	std::vector<unsigned> missing(rules.size(), 0);
+	std::vector<std::vector<unsigned> > occurrences(nonTerminalCount);
+	std::vector<symbol> worklist;
+	for (unsigned r = 0; r < rules.size(); r++) {
+		bool possible = true;
+		for (symbol p : rules[r].product) {
+			if (isTerminalSymbol(p)) {
+				possible = possible && knownTerminal(p);
+			}
+			else {
+				missing[r]++;
+				occurrences[p].push_back(r);
+			}
+		}
+		if (!possible)
+			missing[r] = static_cast<unsigned>(-1) / 2; //never reaches 0
+		else if (missing[r] == 0 && !marked[rules[r].nonTerminal]) {
+			marked[rules[r].nonTerminal] = true;
+			worklist.push_back(rules[r].nonTerminal);
+		}
+	}
+	while (!worklist.empty()) {
+		symbol nt = worklist.back();
+		worklist.pop_back();
+		for (unsigned r : occurrences[nt]) {
+			if (--missing[r] == 0 && !marked[rules[r].nonTerminal]) {
+				marked[rules[r].nonTerminal] = true;
+				worklist.push_back(rules[r].nonTerminal);
+			}
+		}
+	}
+	return marked;
+}
+
+std::vector<bool> nullableNonTerminals(const RuleStore& rules, unsigned nonTerminalCount) {
+	return markHeads(rules, nonTerminalCount, [](symbol t) { return t == EPSILON_SYMBOL; });
+}
+
+std::vector<bool> productiveNonTerminals(const RuleStore& rules, unsigned nonTerminalCount) {
+	return markHeads(rules, nonTerminalCount, [](symbol) { return true; });
+}
+
+//Graph search from start over a CSR index of rules by head, so every rule is looked at once
+std::vector<bool> reachableNonTerminals(const RuleStore& rules, unsigned nonTerminalCount, symbol start,
+	const std::function<bool(const ProductionRule&)>& useRule) {
+	std::vector<unsigned> rulesStart(nonTerminalCount + 1, 0);
+	std::vector<unsigned> ruleIndex;
+	for (const auto& rule : rules) {
+		if (useRule(rule))
+			rulesStart[rule.nonTerminal + 1]++;
+	}
+	for (unsigned nt = 0; nt < nonTerminalCount; nt++)
+		rulesStart[nt + 1] += rulesStart[nt];
+	ruleIndex.resize(rulesStart[nonTerminalCount]);
+	std::vector<unsigned> next(rulesStart.begin(), rulesStart.end() - 1);
+	for (unsigned r = 0; r < rules.size(); r++) {
+		if (useRule(rules[r]))
+			ruleIndex[next[rules[r].nonTerminal]++] = r;
+	}
+
+	std::vector<bool> reached(nonTerminalCount, false);
+	if (start >= nonTerminalCount)
+		return reached;
+	std::vector<symbol> worklist(1, start);
+	reached[start] = true;
+	while (!worklist.empty()) {
+		symbol nt = worklist.back();
+		worklist.pop_back();
+		for (unsigned r = rulesStart[nt]; r < rulesStart[nt + 1]; r++) {
+			for (symbol p : rules[ruleIndex[r]].product) {
+				if (!isTerminalSymbol(p) && !reached[p]) {
+					reached[p] = true;
+					worklist.push_back(p);
+				}
+			}
+		}
+	}
+	return reached;
+}
+
+CompiledGrammar::CompiledGrammar(const RuleStore& rules, unsigned nonTerminalCount, symbol startSymbol) :
+	ntCount(nonTerminalCount), startSymbol(startSymbol), rulesStart(nonTerminalCount + 1, 0), ruleIndex(rules.size()),
+	pairsStart(nonTerminalCount + 1, 0), terminalStart(257, 0), chomsky(true), sorted(true), acceptsEmpty(false) {
+
+	for (unsigned r = 0; r < rules.size(); r++) {
+		const ProductionRule& rule = rules[r];
+		rulesStart[rule.nonTerminal + 1]++;
+		if (r > 0 && rules[r - 1].nonTerminal > rule.nonTerminal)
+			sorted = false;
+
+		if (rule.product.size() == 1 && isTerminalSymbol(rule.product[0])) {
+			terminalStart[static_cast<unsigned char>(terminalOf(rule.product[0])) + 1]++;
+			if (rule.product[0] == EPSILON_SYMBOL && rule.nonTerminal != startSymbol) //only epsilon rule from starting symbol is allowed
+				chomsky = false;
+			else if (rule.product[0] == EPSILON_SYMBOL)
+				acceptsEmpty = true;
+		}
+		else if (rule.product.size() == 2 && !isTerminalSymbol(rule.product[0]) && !isTerminalSymbol(rule.product[1])) {
+			pairsStart[rule.product[0] + 1]++;
+		}
+		else {
+			chomsky = false;
+		}
+	}
+	for (unsigned nt = 0; nt < nonTerminalCount; nt++) {
+		rulesStart[nt + 1] += rulesStart[nt];
+		pairsStart[nt + 1] += pairsStart[nt];
+	}
+	for (unsigned c = 0; c < 256; c++)
+		terminalStart[c + 1] += terminalStart[c];
+
+	//Counting sort keeps rules of every key in grammar order
+	std::vector<unsigned> nextRule(rulesStart.begin(), rulesStart.end() - 1);
+	std::vector<unsigned> nextPair(pairsStart.begin(), pairsStart.end() - 1);
+	std::vector<unsigned> nextTerminal(terminalStart.begin(), terminalStart.end() - 1);
+	pairs.resize(pairsStart[nonTerminalCount]);
+	terminalHeads.resize(terminalStart[256]);
+	terminalRules.resize(terminalStart[256]);
+	logWeights.resize(rules.size());
+	for (unsigned r = 0; r < rules.size(); r++) {
+		const ProductionRule& rule = rules[r];
+		ruleIndex[nextRule[rule.nonTerminal]++] = r;
+		logWeights[r] = static_cast<float>(std::log(rule.weight));
+		if (rule.product.size() == 1 && isTerminalSymbol(rule.product[0])) {
+			unsigned j = nextTerminal[static_cast<unsigned char>(terminalOf(rule.product[0]))]++;
+			terminalHeads[j] = rule.nonTerminal;
+			terminalRules[j] = r;
+		}
+		else if (rule.product.size() == 2 && !isTerminalSymbol(rule.product[0]) && !isTerminalSymbol(rule.product[1]))
+			pairs[nextPair[rule.product[0]]++] = { rule.product[0], rule.product[1], rule.nonTerminal, r };
+	}
+	for (unsigned nt = 0; nt < nonTerminalCount; nt++) {
+		std::stable_sort(pairs.begin() + pairsStart[nt], pairs.begin() + pairsStart[nt + 1],
+			[](const BinaryRule& a, const BinaryRule& b) { return a.second < b.second; });
+	}
+
+	nullableNT = nullableNonTerminals(rules, nonTerminalCount);
+	productiveNT = productiveNonTerminals(rules, nonTerminalCount);
+}
+
+const std::shared_ptr<const CYKRecognizer>& CompiledGrammar::cykRecognizer(const RuleStore& rules) const {
+	std::call_once(cykBuilt, [&]() {
+		if (chomsky)
+			cyk = std::make_shared<const CYKRecognizer>(rules, ntCount, startSymbol);
+	});
+	return cyk;
+}
+
+const EarleyRecognizer& CompiledGrammar::earleyRecognizer(const RuleStore& rules) const {
+	std::call_once(earleyBuilt, [&]() { earley.reset(new EarleyRecognizer(rules, ntCount, startSymbol)); });
+	return *earley;
+}
+
+size_t CompiledGrammar::memoryBytes() const {
+	size_t bytes = sizeof(*this) + heapBytes(rulesStart) + heapBytes(ruleIndex) + heapBytes(pairsStart) + heapBytes(pairs) +
+		heapBytes(terminalStart) + heapBytes(terminalHeads) + heapBytes(terminalRules) + heapBytes(logWeights) +
+		heapBytes(nullableNT) + heapBytes(productiveNT);
+	if (cyk)
+		bytes += cyk->memoryBytes();
+	if (earley)
+		bytes += earley->memoryBytes();
+	return bytes;
+}
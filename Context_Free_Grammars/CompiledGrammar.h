@@ -0,0 +1,84 @@
+#pragma once
+#include "CYKRecognizer.h"
+#include "EarleyRecognizer.h"
+#include "ProducitonRule.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//Non-terminals which derive @ and non-terminals which derive some word. Both are linear-time worklist fixpoints.
+std::vector<bool> nullableNonTerminals(const RuleStore& rules, unsigned nonTerminalCount);
+std::vector<bool> productiveNonTerminals(const RuleStore& rules, unsigned nonTerminalCount);
+//Non-terminals which occur in some sentential form derived from start, using only rules for which useRule(rule) is true
+std::vector<bool> reachableNonTerminals(const RuleStore& rules, unsigned nonTerminalCount, symbol start,
+	const std::function<bool(const ProductionRule&)>& useRule);
+
+//Immutable snapshot of a grammar's rules with every index a query needs. It is built once and cached by Grammar until
+//the grammar changes, so repeated queries on an unchanged grammar do not rescan its rules.
+//Indexes are CSR style: an offsets array per key and one flat array of values. Recognizers are much bigger than the indexes
+//(CYK keeps bitsets of |N| x |N| bits), so they are only built when first asked for, once even if several threads ask.
+class CompiledGrammar {
+public:
+	//Rule A->BC
+	struct BinaryRule {
+		symbol first;
+		symbol second;
+		symbol head;
+		unsigned rule;	//index of the rule in grammar
+	};
+private:
+	unsigned ntCount;
+	symbol startSymbol;
+
+	std::vector<unsigned> rulesStart;		//rules of A are ruleIndex[rulesStart[A] .. rulesStart[A + 1]), in grammar order
+	std::vector<unsigned> ruleIndex;
+	std::vector<unsigned> pairsStart;		//binary rules with first symbol B are pairs[pairsStart[B] .. pairsStart[B + 1]), sorted by second symbol
+	std::vector<BinaryRule> pairs;
+	std::vector<unsigned> terminalStart;	//heads of rules A->c are terminalHeads[terminalStart[c] .. terminalStart[c + 1])
+	std::vector<symbol> terminalHeads;
+	std::vector<unsigned> terminalRules;	//terminalRules[j] is index of the rule terminalHeads[j]->c
+	std::vector<float> logWeights;			//natural logarithm of weight of every rule
+
+	bool chomsky;
+	bool sorted;							//rules of every non-terminal are contiguous and in order of non-terminal ids
+	bool acceptsEmpty;						//S->@ exists
+	std::vector<bool> nullableNT;
+	std::vector<bool> productiveNT;
+
+	mutable std::once_flag cykBuilt;
+	mutable std::shared_ptr<const CYKRecognizer> cyk;	//only for grammars in Chomsky normal form
+	mutable std::once_flag earleyBuilt;
+	mutable std::unique_ptr<const EarleyRecognizer> earley;
+public:
+	CompiledGrammar(const RuleStore& rules, unsigned nonTerminalCount, symbol startSymbol);
+
+	unsigned nonTerminalCount() const { return ntCount; }
+	symbol startingSymbol() const { return startSymbol; }
+
+	unsigned rulesOfCount(symbol nt) const { return rulesStart[nt + 1] - rulesStart[nt]; }
+	const unsigned* rulesOfBegin(symbol nt) const { return ruleIndex.data() + rulesStart[nt]; }
+	const unsigned* rulesOfEnd(symbol nt) const { return ruleIndex.data() + rulesStart[nt + 1]; }
+
+	const BinaryRule* pairsOfBegin(symbol first) const { return pairs.data() + pairsStart[first]; }
+	const BinaryRule* pairsOfEnd(symbol first) const { return pairs.data() + pairsStart[first + 1]; }
+
+	const symbol* terminalHeadsBegin(char c) const { return terminalHeads.data() + terminalStart[static_cast<unsigned char>(c)]; }
+	const symbol* terminalHeadsEnd(char c) const { return terminalHeads.data() + terminalStart[static_cast<unsigned char>(c) + 1]; }
+	const unsigned* terminalRulesBegin(char c) const { return terminalRules.data() + terminalStart[static_cast<unsigned char>(c)]; }
+	const unsigned* terminalRulesEnd(char c) const { return terminalRules.data() + terminalStart[static_cast<unsigned char>(c) + 1]; }
+
+	float logWeight(unsigned rule) const { return logWeights[rule]; }
+
+	bool isChomsky() const { return chomsky; }
+	bool rulesSorted() const { return sorted; }
+	bool nullable(symbol nt) const { return nullableNT[nt]; }
+	bool productive(symbol nt) const { return productiveNT[nt]; }
+	bool emptyWordAccepted() const { return acceptsEmpty; }
+
+	//rules have to be the ones the snapshot was built from. nullptr if grammar is not in Chomsky normal form.
+	const std::shared_ptr<const CYKRecognizer>& cykRecognizer(const RuleStore& rules) const;
+	const EarleyRecognizer& earleyRecognizer(const RuleStore& rules) const;
+	//Indexes and the recognizers built so far. Not to be called while other threads may still be building a recognizer.
+	size_t memoryBytes() const;
+};
@@ -0,0 +1,175 @@
+#include "Composition.h"
+#include "Grammar.h"
+#include <algorithm>
+
+std::shared_ptr<const Composition> Composition::leaf(std::shared_ptr<const Grammar> grammar) {
+	std::shared_ptr<Composition> node(new Composition());
+	node->ntCount = grammar->nonTerminalCount();
+	node->rulesCount = grammar->getRules().size();
+	node->grammar = std::move(grammar);
+	return node;
+}
+
+std::shared_ptr<const Composition> Composition::combine(Kind kind, const std::vector<std::shared_ptr<const Composition> >& operands) {
+	assert(kind != Kind::LEAF && !operands.empty() && (kind != Kind::ITER || operands.size() == 1));
+	std::shared_ptr<Composition> node(new Composition());
+	node->nodeKind = kind;
+	node->children = operands;
+	unsigned long long count = 0;
+	for (const auto& operand : operands) {
+		node->offsets.push_back(static_cast<symbol>(count));
+		count += operand->ntCount;
+		node->rulesCount += operand->rulesCount;
+	}
+	count++; //new starting symbol
+	if (count >= NO_SYMBOL)
+		return nullptr;
+	node->ntCount = static_cast<unsigned>(count);
+	switch (kind) {
+	case Kind::UNION: node->rulesCount += operands.size(); break; //S->S1 | S2 | ...
+	case Kind::CONCAT: node->rulesCount += 1; break; //S->S1S2...
+	default: node->rulesCount += 2; break; //S->@ | S1S
+	}
+	return node;
+}
+
+bool Composition::sameTerminals(const Composition& other) const {
+	return firstLeaf().sameTerminals(other.firstLeaf());
+}
+
+bool Composition::prepare(Recognizer recognizer, std::vector<unsigned>& notChomsky) const {
+	std::unordered_map<const Composition*, bool> checked;
+	return prepare(recognizer, checked, notChomsky);
+}
+
+bool Composition::prepare(Recognizer recognizer, std::unordered_map<const Composition*, bool>& checked, std::vector<unsigned>& notChomsky) const {
+	auto found = checked.find(this);
+	if (found != checked.end())
+		return found->second;
+	bool ready = true;
+	if (nodeKind == Kind::LEAF) {
+		if (recognizer == Recognizer::CYK) {
+			ready = grammar->Chomsky();
+			if (ready)
+				grammar->cykRecognizer();
+			else if (std::find(notChomsky.begin(), notChomsky.end(), grammar->get_id()) == notChomsky.end())
+				notChomsky.push_back(grammar->get_id()); //leaves of the same grammar are different copies
+		}
+		else
+			grammar->earleyRecognizer();
+	}
+	else {
+		for (const auto& child : children)
+			ready = child->prepare(recognizer, checked, notChomsky) && ready;
+	}
+	checked.emplace(this, ready);
+	return ready;
+}
+
+bool Composition::recognize(const std::string& word, Recognizer recognizer, ThreadPool* pool) const {
+	Query query = { word, recognizer, pool, {}, {} };
+	return recognize(query);
+}
+
+bool Composition::recognize(Query& query) const {
+	auto found = query.recognized.find(this);
+	if (found != query.recognized.end())
+		return found->second;
+	bool recognized = false;
+	switch (nodeKind) {
+	case Kind::LEAF:
+		if (query.recognizer == Recognizer::CYK && query.pool != nullptr) {
+			std::vector<bitWord> chart;
+			recognized = grammar->cykRecognizer()->recognize(query.word.data(), static_cast<unsigned>(query.word.length()), chart, *query.pool);
+		}
+		else if (query.recognizer == Recognizer::CYK)
+			recognized = grammar->cykRecognizer()->recognize(query.word);
+		else
+			recognized = grammar->earleyRecognizer().recognize(query.word);
+		break;
+	case Kind::UNION:
+		for (const auto& child : children) {
+			if (child->recognize(query)) {
+				recognized = true;
+				break;
+			}
+		}
+		break;
+	default:
+		recognized = spans(query).test(0, static_cast<unsigned>(query.word.length()));
+		break;
+	}
+	query.recognized.emplace(this, recognized);
+	return recognized;
+}
+
+const Composition::SpanTable& Composition::spans(Query& query) const {
+	auto found = query.spans.find(this);
+	if (found != query.spans.end())
+		return found->second;
+	const std::string& word = query.word;
+	const unsigned n = static_cast<unsigned>(word.length());
+	SpanTable table(n);
+	const unsigned words = table.rowWords();
+	switch (nodeKind) {
+	case Kind::LEAF:
+		if (query.recognizer == Recognizer::CYK) {
+			const CYKRecognizer& cyk = *grammar->cykRecognizer();
+			std::vector<bitWord> chart;
+			if (query.pool != nullptr)
+				cyk.fillChart(word.data(), n, chart, *query.pool);
+			else
+				cyk.fillChart(word.data(), n, chart);
+			for (unsigned len = 0; len < n; len++) {
+				for (unsigned i = 0; i + len < n; i++) {
+					if (cyk.startDerives(chart, n, i, len))
+						table.set(i, i + len + 1);
+				}
+			}
+			if (cyk.emptyWordAccepted()) {
+				for (unsigned i = 0; i <= n; i++)
+					table.set(i, i);
+			}
+		}
+		else { //one Earley pass with the starting symbol predicted at every position
+			grammar->earleyRecognizer().acceptedSpans(word, [&](unsigned i, unsigned j) { table.set(i, j); });
+		}
+		break;
+	case Kind::UNION:
+		for (const auto& child : children) {
+			const SpanTable& operand = child->spans(query);
+			for (unsigned i = 0; i <= n; i++)
+				orInto(table.row(i), operand.row(i), words);
+		}
+		break;
+	case Kind::CONCAT: {
+		//Spans of S1...Sk: span [i, j) extended by every span of next operand starting at j
+		SpanTable prefix = children[0]->spans(query);
+		for (unsigned c = 1; c < children.size(); c++) {
+			const SpanTable& next = children[c]->spans(query);
+			SpanTable extended(n);
+			for (unsigned i = 0; i <= n; i++) {
+				forEachBit(prefix.row(i), words, [&](unsigned j) {
+					orInto(extended.row(i), next.row(j), words);
+				});
+			}
+			prefix = std::move(extended);
+		}
+		table = std::move(prefix);
+		break;
+	}
+	case Kind::ITER: {
+		//Zero or more non-empty pieces. Row i is {i} and every row k reachable by one piece [i, k), filled right to left.
+		const SpanTable& piece = children[0]->spans(query);
+		for (unsigned i = n + 1; i-- > 0;) {
+			table.set(i, i);
+			forEachBit(piece.row(i), words, [&](unsigned k) {
+				if (k > i)
+					orInto(table.row(i), table.row(k), words);
+			});
+		}
+		break;
+	}
+	}
+	return query.spans.emplace(this, std::move(table)).first->second;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "BitKernel.h"
+#include "Symbol.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Grammar;
+class ThreadPool;
+
+//Lazy result of union, concat and iter: a DAG whose leaves are snapshots of grammars and whose inner nodes combine their
+//operands. Nothing is renamed or copied when a node is built. The node's non-terminals form one id space in which operand k
+//starts at offset(k), followed by the node's own new starting symbol - exactly the ids the flattened grammar gets, so renaming
+//is only an addition. Grammar(const Composition&) flattens a node when its rules are needed.
+//Membership is decided without flattening: a union asks its operands' recognizers, concat and iter combine which spans of the
+//word their operands derive.
+class Composition {
+public:
+	enum class Kind { LEAF, UNION, CONCAT, ITER };
+	enum class Recognizer { CYK, EARLEY };
+private:
+	//Row i is the bitset of all j such that word[i..j) is in the language
+	class SpanTable {
+	private:
+		unsigned words;
+		std::vector<bitWord> bits;
+	public:
+		explicit SpanTable(unsigned n) : words(bitsetWords(n + 1)), bits((n + 1) * static_cast<size_t>(words), 0) {}
+		unsigned rowWords() const { return words; }
+		bitWord* row(unsigned i) { return &bits[i * static_cast<size_t>(words)]; }
+		const bitWord* row(unsigned i) const { return &bits[i * static_cast<size_t>(words)]; }
+		void set(unsigned i, unsigned j) { setBit(row(i), j); }
+		bool test(unsigned i, unsigned j) const { return testBit(row(i), j); }
+	};
+	//Results for one word, so a node used several times in the DAG is evaluated once
+	struct Query {
+		const std::string& word;
+		Recognizer recognizer;
+		ThreadPool* pool;	//CYK charts of leaves are filled on it if not nullptr
+		std::unordered_map<const Composition*, bool> recognized;
+		std::unordered_map<const Composition*, SpanTable> spans;
+	};
+
+	Kind nodeKind;
+	std::shared_ptr<const Grammar> grammar; //only for LEAF
+	std::vector<std::shared_ptr<const Composition> > children;
+	std::vector<symbol> offsets; //offsets[k] is id of first non-terminal of children[k]
+	unsigned ntCount;
+	size_t rulesCount;
+
+	Composition() : nodeKind(Kind::LEAF), grammar(), children(), offsets(), ntCount(0), rulesCount(0) {}
+
+	bool recognize(Query& query) const;
+	const SpanTable& spans(Query& query) const;
+	bool prepare(Recognizer recognizer, std::unordered_map<const Composition*, bool>& checked, std::vector<unsigned>& notChomsky) const;
+public:
+	//grammar must not change while the node lives - pass a copy, copies of grammars share their rules
+	static std::shared_ptr<const Composition> leaf(std::shared_ptr<const Grammar> grammar);
+	//Returns nullptr if the result would have more non-terminals than ids. ITER takes exactly one operand.
+	static std::shared_ptr<const Composition> combine(Kind kind, const std::vector<std::shared_ptr<const Composition> >& operands);
+
+	Kind kind() const { return nodeKind; }
+	const Grammar& leafGrammar() const { return *grammar; }
+	const Grammar& firstLeaf() const { return nodeKind == Kind::LEAF ? *grammar : children[0]->firstLeaf(); }
+	const std::vector<std::shared_ptr<const Composition> >& operands() const { return children; }
+	symbol offset(unsigned operand) const { return offsets[operand]; }
+	unsigned nonTerminalCount() const { return ntCount; }
+	size_t ruleCount() const { return rulesCount; }
+	bool sameTerminals(const Composition& other) const;
+
+	//Checks every operand grammar can be used with recognizer - CYK needs operands (not the result) in Chomsky normal form.
+	//Builds every operand's recognizer, so recognize can then be called from several threads.
+	//Ids of operand grammars which are not in Chomsky normal form are added to notChomsky, each once.
+	bool prepare(Recognizer recognizer, std::vector<unsigned>& notChomsky) const;
+	//If pool is not nullptr, CYK leaves fill their charts on it. Earley leaves always run serially.
+	bool recognize(const std::string& word, Recognizer recognizer, ThreadPool* pool = nullptr) const;
+};
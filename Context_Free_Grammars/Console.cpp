@@ -0,0 +1,28 @@
+#include "Console.h"
+
+std::string BLACK_TEXT = "\x1B[30m";
+std::string RED_TEXT = "\x1B[31m";
+std::string GREEN_TEXT = "\x1B[32m";
+std::string YELLOW_TEXT = "\x1B[33m";
+std::string BLUE_TEXT = "\x1B[34m";
+std::string MAGENTA_TEXT = "\x1B[35m";
+std::string CYAN_TEXT = "\x1B[36m";
+std::string WHITE_TEXT = "\x1B[37m";
+std::string BRIGHT_BLACK_TEXT = "\x1B[90m";
+std::string BRIGHT_RED_TEXT = "\x1B[91m";
+std::string BRIGHT_GREEN_TEXT = "\x1B[92m";
+std::string BRIGHT_YELLOW_TEXT = "\x1B[93m";
+std::string BRIGHT_BLUE_TEXT = "\x1B[94m";
+std::string BRIGHT_MAGENTA_TEXT = "\x1B[95m";
+std::string BRIGHT_CYAN_TEXT = "\x1B[96m";
+std::string BRIGHT_WHITE_TEXT = "\x1B[97m";
+std::string RESET_COLORING = "\033[0m";
+
+void disableColoring() {
+	std::string* codes[] = {
+		&BLACK_TEXT, &RED_TEXT, &GREEN_TEXT, &YELLOW_TEXT, &BLUE_TEXT, &MAGENTA_TEXT, &CYAN_TEXT, &WHITE_TEXT,
+		&BRIGHT_BLACK_TEXT, &BRIGHT_RED_TEXT, &BRIGHT_GREEN_TEXT, &BRIGHT_YELLOW_TEXT, &BRIGHT_BLUE_TEXT, &BRIGHT_MAGENTA_TEXT, &BRIGHT_CYAN_TEXT, &BRIGHT_WHITE_TEXT, &RESET_COLORING
+	};
+	for (std::string* code : codes)
+		code->clear();
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+//ANSI colour codes put around console messages. They are empty after disableColoring(), i.e. when output is read by a script.
+extern std::string BLACK_TEXT;
+extern std::string RED_TEXT;
+extern std::string GREEN_TEXT;
+extern std::string YELLOW_TEXT;
+extern std::string BLUE_TEXT;
+extern std::string MAGENTA_TEXT;
+extern std::string CYAN_TEXT;
+extern std::string WHITE_TEXT;
+extern std::string BRIGHT_BLACK_TEXT;
+extern std::string BRIGHT_RED_TEXT;
+extern std::string BRIGHT_GREEN_TEXT;
+extern std::string BRIGHT_YELLOW_TEXT;
+extern std::string BRIGHT_BLUE_TEXT;
+extern std::string BRIGHT_MAGENTA_TEXT;
+extern std::string BRIGHT_CYAN_TEXT;
+extern std::string BRIGHT_WHITE_TEXT;
+extern std::string RESET_COLORING;
+
+void disableColoring();
@@ -0,0 +1,150 @@
+#pragma once
+#include "BitKernel.h"
+#include "BigCount.h"
+#include "CompiledGrammar.h"
+#include <string>
+#include <vector>
+
+//Count which stops growing at 2^64 - 1
+class SaturatingCount {
+private:
+	unsigned long long value;
+public:
+	static const unsigned long long MAX = ~0ULL;
+
+	SaturatingCount(unsigned long long value = 0) : value(value) {}
+
+	bool isZero() const { return value == 0; }
+	bool moreThanOne() const { return value > 1; }
+	bool saturated() const { return value == MAX; }
+	unsigned long long get() const { return value; }
+
+	SaturatingCount& operator += (const SaturatingCount& other) {
+		value = value > MAX - other.value ? MAX : value + other.value;
+		return *this;
+	}
+	SaturatingCount operator * (const SaturatingCount& other) const {
+		return other.value != 0 && value > MAX / other.value ? SaturatingCount(MAX) : SaturatingCount(value * other.value);
+	}
+	bool operator < (const SaturatingCount& other) const { return value < other.value; }
+
+	std::string toString() const { return saturated() ? "at least " + std::to_string(value) : std::to_string(value); }
+};
+
+//CYK over a grammar in Chomsky normal form which keeps, instead of one bit, the number of derivations of every span by every
+//non-terminal: count(A, i, len) is the sum over rules A->BC and split points k of count(B, i, k) * count(C, i + k, len - k).
+//Every cell also lists the non-terminals with a non-zero count, so only those are combined.
+//Count is SaturatingCount or BigCount.
+template <typename Count>
+class DerivationCounts {
+private:
+	const CompiledGrammar& index;
+	unsigned n;
+	unsigned ntCount;
+	std::vector<Count> counts;				//counts[cellIndex(i, len) * ntCount + A]
+	std::vector<std::vector<symbol> > present;	//present[cellIndex(i, len)] = {A | count(A, i, len) > 0}
+
+	//Span of len letters (1..n) starting at i, see spanCell
+	size_t cellIndex(unsigned i, unsigned len) const { return spanCell(n, i, len); }
+	size_t cellCount() const { return spanCellCount(n); }
+	Count& at(symbol nt, unsigned i, unsigned len) { return counts[cellIndex(i, len) * ntCount + nt]; }
+public:
+	DerivationCounts(const CompiledGrammar& index, const std::string& word);
+
+	unsigned length() const { return n; }
+	const Count& count(symbol nt, unsigned i, unsigned len) const { return counts[cellIndex(i, len) * ntCount + nt]; }
+	//Number of parse trees of the whole word
+	Count total() const;
+	//Shortest span (leftmost of those) which some non-terminal derives in more than one way, counting only spans which are part of
+	//some parse tree of the whole word. Returns false if the word has at most one parse tree.
+	bool smallestAmbiguousSpan(symbol& nt, unsigned& start, unsigned& len) const;
+};
+
+template <typename Count>
+DerivationCounts<Count>::DerivationCounts(const CompiledGrammar& index, const std::string& word)
+	: index(index), n(static_cast<unsigned>(word.length())), ntCount(index.nonTerminalCount()),
+	counts(), present() {
+	counts.resize(cellCount() * ntCount);
+	present.resize(cellCount());
+	for (unsigned i = 0; i < n; i++) {
+		for (const symbol* head = index.terminalHeadsBegin(word[i]); head != index.terminalHeadsEnd(word[i]); head++) {
+			at(*head, i, 1) = Count(1); //rules are unique, so A->c gives one derivation
+			present[cellIndex(i, 1)].push_back(*head);
+		}
+	}
+	for (unsigned len = 2; len <= n; len++) {
+		for (unsigned i = 0; i + len <= n; i++) {
+			std::vector<symbol>& heads = present[cellIndex(i, len)];
+			for (unsigned k = 1; k < len; k++) {
+				const size_t right = cellIndex(i + k, len - k);
+				for (symbol first : present[cellIndex(i, k)]) {
+					const Count& leftCount = count(first, i, k);
+					for (const CompiledGrammar::BinaryRule* rule = index.pairsOfBegin(first); rule != index.pairsOfEnd(first); rule++) {
+						const Count& rightCount = counts[right * ntCount + rule->second];
+						if (rightCount.isZero())
+							continue;
+						Count& target = at(rule->head, i, len);
+						if (target.isZero())
+							heads.push_back(rule->head);
+						target += leftCount * rightCount;
+					}
+				}
+			}
+		}
+	}
+}
+
+template <typename Count>
+Count DerivationCounts<Count>::total() const {
+	const symbol start = index.startingSymbol();
+	if (n == 0)
+		return Count(index.emptyWordAccepted() ? 1 : 0);
+	if (start >= ntCount)
+		return Count(0);
+	return count(start, 0, n);
+}
+
+//Spans used by some parse tree are marked top-down from the whole word, then the shortest marked one with count > 1 is taken
+template <typename Count>
+bool DerivationCounts<Count>::smallestAmbiguousSpan(symbol& nt, unsigned& start, unsigned& len) const {
+	if (!total().moreThanOne())
+		return false;
+	std::vector<char> used(counts.size(), 0);
+	used[cellIndex(0, n) * ntCount + index.startingSymbol()] = 1;
+	for (unsigned l = n; l >= 2; l--) {
+		for (unsigned i = 0; i + l <= n; i++) {
+			const size_t cell = cellIndex(i, l);
+			bool anyUsed = false;
+			for (symbol head : present[cell])
+				anyUsed = anyUsed || used[cell * ntCount + head];
+			if (!anyUsed)
+				continue;
+			for (unsigned k = 1; k < l; k++) {
+				const size_t left = cellIndex(i, k);
+				const size_t right = cellIndex(i + k, l - k);
+				for (symbol first : present[left]) {
+					for (const CompiledGrammar::BinaryRule* rule = index.pairsOfBegin(first); rule != index.pairsOfEnd(first); rule++) {
+						if (used[cell * ntCount + rule->head] && !counts[right * ntCount + rule->second].isZero()) {
+							used[left * ntCount + first] = 1;
+							used[right * ntCount + rule->second] = 1;
+						}
+					}
+				}
+			}
+		}
+	}
+	for (unsigned l = 2; l <= n; l++) {
+		for (unsigned i = 0; i + l <= n; i++) {
+			const size_t cell = cellIndex(i, l);
+			for (symbol head : present[cell]) {
+				if (used[cell * ntCount + head] && counts[cell * ntCount + head].moreThanOne()) {
+					nt = head;
+					start = i;
+					len = l;
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,106 @@
+#ifdef DISPATCH_BENCH
+#include "DispatchBench.h"
+#include "Console.h"
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <string>
+#include <vector>
+
+using std::cerr;
+using std::cout;
+using std::regex;
+using std::sregex_iterator;
+using std::string;
+using std::vector;
+
+//Regular expressions the commands were matched with before the command table, tried in the same order
+static const char* const LEGACY_COMMAND_PATTERNS[] = {
+	R"(^quit$)",
+	R"(^open \"((?:[^\"\s]|[ ])+)|(\"([^\"]+)\")\"$)",
+	R"(^save ([1-9]\d*|0) \"((?:[^\"\s]|[ ])+)|(\"([^\"]+)\")\"$)",
+	R"(^open-bin \"((?:[^\"\s]|[ ])+)\"$)",
+	R"(^save-bin ([1-9]\d*|0) \"((?:[^\"\s]|[ ])+)\"$)",
+	R"(^list$)",
+	R"(^print ([1-9]\d*|0)$)",
+	R"(^add rule ([1-9]\d*|0) \"([\w\->]+)\"$)",
+	R"(^remove rule ([1-9]\d*|0) ([1-9]\d*|0)$)",
+	R"(^union ([1-9]\d*|0) ([1-9]\d*|0)$)",
+	R"(^concat ([1-9]\d*|0) ([1-9]\d*|0)$)",
+	R"(^iter ([1-9]\d*|0)$)",
+	R"(^chomskify ([1-9]\d*|0)$)",
+	R"(^chomsky ([1-9]\d*|0)$)",
+	R"(^empty ([1-9]\d*|0)$)",
+	R"(^reduce ([1-9]\d*|0)$)",
+	R"(^CYK ([1-9]\d*|0) \"([a-z\d]+)\"(?: threads=([1-9]\d*))?$)",
+	R"(^cyk-words ([1-9]\d*|0)((?: \"[a-z\d]+\")+)$)",
+	R"(^cyk-prefixes ([1-9]\d*|0) \"([a-z\d]+)\"$)",
+	R"(^earley ([1-9]\d*|0) \"([a-z\d]+)\"$)",
+	R"(^cyk-batch ([1-9]\d*|0) \"((?:[^\"\s]|[ ])+)\" \"((?:[^\"\s]|[ ])+)\"(?: threads=([1-9]\d*))?$)",
+	R"(^copy ([1-9]\d*|0)$)",
+	R"(^commands$)"
+};
+
+static const char* const BENCHMARK_COMMANDS[] = {
+	"CYK 0 \"aabbab\"", "CYK 12 \"ab\" threads=4", "earley 3 \"aaaabbbb\"", "cyk-words 1 \"ab\" \"aabb\" \"b\"",
+	"add rule 0 \"S->aA_1_b\"", "remove rule 2 10", "union 0 1", "concat 4 2", "chomskify 7", "chomsky 7", "empty 0",
+	"print 3", "open \"grammars/big grammar.txt\"", "save 1 \"out.txt\"", "cyk-batch 0 \"corpus.txt\" \"results.txt\"",
+	"list", "commands", "CYK 0 \"Ab\"", "print 01", "union 0  1", "hello world", "cyk-words 1"
+};
+
+//Both ways must agree on every sample line, otherwise timings would compare different work. The former expressions are
+//not anchored inside their alternatives, so they also took lines like 'open "f" junk' which the command table rejects.
+void benchDispatch(const CommandParser& parser, unsigned rounds) {
+	vector<regex> patterns;
+	for (const char* pattern : LEGACY_COMMAND_PATTERNS)
+		patterns.push_back(regex(pattern));
+	vector<string> lines(std::begin(BENCHMARK_COMMANDS), std::end(BENCHMARK_COMMANDS));
+	auto legacyMatch = [&](const string& line) {
+		for (const regex& pattern : patterns) {
+			if (sregex_iterator(line.begin(), line.end(), pattern) != sregex_iterator())
+				return true;
+		}
+		return false;
+	};
+
+	ParsedCommand parsed;
+	bool agree = true;
+	for (const string& line : lines) {
+		bool legacy = legacyMatch(line);
+		bool table = parser.parse(line, parsed);
+		if (legacy != table) {
+			cerr << RED_TEXT << "Line '" << line << "' is " << (legacy ? "" : "not ") << "a command for regular expressions but "
+				<< (table ? "" : "not ") << "for command table!" << RESET_COLORING << '\n';
+			agree = false;
+		}
+	}
+	if (!agree)
+		return;
+
+	unsigned legacyMatches = 0;
+	auto started = std::chrono::steady_clock::now();
+	for (unsigned round = 0; round < rounds; round++) {
+		for (const string& line : lines)
+			legacyMatches += legacyMatch(line);
+	}
+	double legacySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	unsigned tableMatches = 0;
+	started = std::chrono::steady_clock::now();
+	for (unsigned round = 0; round < rounds; round++) {
+		for (const string& line : lines)
+			tableMatches += parser.parse(line, parsed);
+	}
+	double tableSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	double dispatched = static_cast<double>(rounds) * lines.size();
+	double legacyNs = dispatched > 0 ? legacySeconds * 1e9 / dispatched : 0.0;
+	double tableNs = dispatched > 0 ? tableSeconds * 1e9 / dispatched : 0.0;
+	cout << CYAN_TEXT << "Dispatched " << dispatched << " command lines (" << tableMatches << " valid commands)." << RESET_COLORING << '\n';
+	cout << CYAN_TEXT << "Regular expressions: " << legacyNs << " ns per command" << RESET_COLORING << '\n';
+	cout << CYAN_TEXT << "Command table: " << tableNs << " ns per command" << RESET_COLORING << '\n';
+	if (tableNs > 0)
+		cout << BRIGHT_GREEN_TEXT << "Command table is " << legacyNs / tableNs << " times faster." << RESET_COLORING << '\n';
+}
+#endif
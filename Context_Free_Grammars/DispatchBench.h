@@ -0,0 +1,6 @@
+#pragma once
+#include "CommandParser.h"
+
+//Benchmark of command recognition, only built with DISPATCH_BENCH defined so normal builds do not carry <regex>.
+//Times parser over rounds of sample lines against the regular expressions commands were matched with before it.
+void benchDispatch(const CommandParser& parser, unsigned rounds);
@@ -0,0 +1,216 @@
+#include "EarleyRecognizer.h"
+#include <unordered_set>
+
+EarleyRecognizer::EarleyRecognizer(const RuleStore& rules, unsigned nonTerminalCount, symbol startSymbol) :
+	startSymbol(startSymbol), root(startSymbol < nonTerminalCount ? nonTerminalCount : NO_SYMBOL), rulesStart(nonTerminalCount + 2, 0),
+	ruleIndex(rules.size() + 1), nullable(nonTerminalCount + 1, false) {
+	productStart.reserve(rules.size() + 2);
+	productStart.push_back(0);
+	for (const auto& rule : rules) {
+		lhs.push_back(rule.nonTerminal);
+		for (symbol p : rule.product) {
+			if (p != EPSILON_SYMBOL)
+				products.push_back(p);
+		}
+		productStart.push_back(static_cast<unsigned>(products.size()));
+		rulesStart[rule.nonTerminal + 1]++;
+	}
+	lhs.push_back(nonTerminalCount); //S'->S, without rules of S' if there is no starting symbol
+	if (root != NO_SYMBOL) {
+		products.push_back(startSymbol);
+		rulesStart[root + 1]++;
+	}
+	productStart.push_back(static_cast<unsigned>(products.size()));
+	for (unsigned nt = 0; nt <= nonTerminalCount; nt++)
+		rulesStart[nt + 1] += rulesStart[nt];
+	ruleIndex.resize(rulesStart.back());
+	std::vector<unsigned> filled(rulesStart.begin(), rulesStart.end() - 1);
+	for (unsigned r = 0; r < lhs.size(); r++) {
+		if (r < rules.size() || root != NO_SYMBOL)
+			ruleIndex[filled[lhs[r]]++] = r;
+	}
+
+	//Nullable non-terminals with a worklist: every rule counts the symbols of its product which are not known to be nullable yet
+	std::vector<unsigned> missing(lhs.size());
+	std::vector<std::vector<unsigned> > occurrences(nonTerminalCount + 1); //rules in which non-terminal occurs, once per occurrence
+	std::vector<symbol> worklist;
+	for (unsigned r = 0; r < lhs.size(); r++) {
+		if (r == rules.size() && root == NO_SYMBOL)
+			break;
+		missing[r] = productLength(r);
+		for (unsigned p = productStart[r]; p < productStart[r + 1]; p++) {
+			if (!isTerminalSymbol(products[p]))
+				occurrences[products[p]].push_back(r);
+		}
+		if (missing[r] == 0 && !nullable[lhs[r]]) {
+			nullable[lhs[r]] = true;
+			worklist.push_back(lhs[r]);
+		}
+	}
+	while (!worklist.empty()) {
+		symbol nt = worklist.back();
+		worklist.pop_back();
+		for (unsigned r : occurrences[nt]) {
+			if (--missing[r] == 0 && !nullable[lhs[r]]) {
+				nullable[lhs[r]] = true;
+				worklist.push_back(lhs[r]);
+			}
+		}
+	}
+}
+
+size_t EarleyRecognizer::memoryBytes() const {
+	return sizeof(*this) + heapBytes(lhs) + heapBytes(productStart) + heapBytes(products) + heapBytes(rulesStart) + heapBytes(ruleIndex) + heapBytes(nullable);
+}
+
+bool EarleyRecognizer::recognize(const std::string& word) const {
+	return run(word, false, nullptr);
+}
+
+std::vector<char> EarleyRecognizer::acceptedPrefixes(const std::string& word) const {
+	std::vector<char> prefixes(word.length() + 1, 0);
+	std::function<void(unsigned, unsigned)> found = [&](unsigned, unsigned j) { prefixes[j] = 1; };
+	run(word, false, &found);
+	return prefixes;
+}
+
+void EarleyRecognizer::acceptedSpans(const std::string& word, const std::function<void(unsigned, unsigned)>& found) const {
+	run(word, true, &found);
+}
+
+//Follows the chain of single waiting items up from (origin, nt) until a set where the chain is memoized or stops, then
+//memoizes the result for every link of the chain. A link is marked as having no Leo item before moving on, which ends
+//chains of unit rules that lead back to it.
+bool EarleyRecognizer::transitiveItem(std::vector<ItemSet>& sets, unsigned origin, symbol nt, Item& top) const {
+	struct Link {
+		unsigned set;
+		symbol nt;
+		Item advanced; //the single waiting item with the dot moved over nt
+	};
+	std::vector<Link> chain;
+	Item found = { NO_RULE, 0, 0 };
+	while (true) {
+		ItemSet& set = sets[origin];
+		auto memo = set.transitive.find(nt);
+		if (memo != set.transitive.end()) {
+			found = memo->second;
+			break;
+		}
+		auto waiting = set.waiting.find(nt);
+		if (waiting == set.waiting.end() || waiting->second.size() != 1) {
+			set.transitive.emplace(nt, found);
+			break;
+		}
+		Item parent = set.items[waiting->second[0]];
+		if (parent.dot + 1 != productLength(parent.rule)) {
+			set.transitive.emplace(nt, found);
+			break;
+		}
+		parent.dot++;
+		set.transitive.emplace(nt, found);
+		chain.push_back({ origin, nt, parent });
+		origin = parent.origin;
+		nt = lhs[parent.rule];
+	}
+	for (size_t k = chain.size(); k-- > 0;) {
+		if (found.rule == NO_RULE)
+			found = chain[k].advanced;
+		sets[chain[k].set].transitive[chain[k].nt] = found;
+	}
+	if (found.rule == NO_RULE)
+		return false;
+	top = found;
+	return true;
+}
+
+bool EarleyRecognizer::run(const std::string& word, bool everyOrigin, const std::function<void(unsigned, unsigned)>* recognized) const {
+	const unsigned n = static_cast<unsigned>(word.length());
+	if (root == NO_SYMBOL)
+		return false;
+	if (n == 0) {
+		if (recognized != nullptr && nullable[root])
+			(*recognized)(0, 0);
+		return nullable[root];
+	}
+
+	std::vector<ItemSet> sets(n + 1);
+	//Items are unique within a set. Only the set being processed and the next one receive items so only their keys are kept.
+	std::unordered_set<unsigned long long> seenCurrent, seenNext;
+	auto key = [this](const Item& item) { //rule r has dot positions productStart[r] + r .. productStart[r + 1] + r so this is unique
+		return (static_cast<unsigned long long>(productStart[item.rule] + item.rule + item.dot) << 32) | item.origin;
+	};
+	auto addItem = [&](ItemSet& set, std::unordered_set<unsigned long long>& seen, const Item& item) {
+		if (seen.insert(key(item)).second)
+			set.items.push_back(item);
+	};
+
+	std::vector<bool> predicted(nullable.size(), false);
+	std::vector<symbol> predictedList; //to reset predicted after every set
+	for (unsigned j = 0; j <= n; j++) {
+		ItemSet& current = sets[j];
+		if (j == 0 || everyOrigin) {
+			predicted[root] = true;
+			predictedList.push_back(root);
+			for (unsigned r = rulesStart[root]; r < rulesStart[root + 1]; r++)
+				addItem(current, seenCurrent, { ruleIndex[r], 0, j });
+		}
+		const symbol letter = j < n ? terminalSymbol(word[j]) : NO_SYMBOL;
+		for (unsigned i = 0; i < current.items.size(); i++) {
+			const Item item = current.items[i];
+			if (item.dot == productLength(item.rule)) { //complete
+				if (item.origin == j)	//nullable non-terminal - already moved over at prediction
+					continue;
+				Item top;
+				if (transitiveItem(sets, item.origin, lhs[item.rule], top)) {
+					addItem(current, seenCurrent, top);
+					continue;
+				}
+				auto found = sets[item.origin].waiting.find(lhs[item.rule]);
+				if (found == sets[item.origin].waiting.end())
+					continue;
+				for (unsigned w : found->second) {
+					Item parent = sets[item.origin].items[w];
+					parent.dot++;
+					addItem(current, seenCurrent, parent);
+				}
+			}
+			else {
+				symbol next = afterDot(item);
+				if (isTerminalSymbol(next)) { //scan
+					if (next == letter)
+						addItem(sets[j + 1], seenNext, { item.rule, item.dot + 1, item.origin });
+				}
+				else { //predict
+					current.waiting[next].push_back(i);
+					if (!predicted[next]) {
+						predicted[next] = true;
+						predictedList.push_back(next);
+						for (unsigned r = rulesStart[next]; r < rulesStart[next + 1]; r++)
+							addItem(current, seenCurrent, { ruleIndex[r], 0, j });
+					}
+					if (nullable[next])
+						addItem(current, seenCurrent, { item.rule, item.dot + 1, item.origin });
+				}
+			}
+		}
+		for (symbol nt : predictedList)
+			predicted[nt] = false;
+		predictedList.clear();
+		if (recognized != nullptr) {
+			for (const auto& item : current.items) {
+				if (lhs[item.rule] == root && item.dot == productLength(item.rule) && (everyOrigin || item.origin == 0))
+					(*recognized)(item.origin, j);
+			}
+		}
+		if (j < n && sets[j + 1].items.empty() && !everyOrigin) //nothing could be scanned
+			return false;
+		seenCurrent.swap(seenNext);
+		seenNext.clear();
+	}
+
+	for (const auto& item : sets[n].items) {
+		if (item.origin == 0 && lhs[item.rule] == root && item.dot == productLength(item.rule))
+			return true;
+	}
+	return false;
+}
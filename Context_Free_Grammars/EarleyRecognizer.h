@@ -0,0 +1,59 @@
+#pragma once
+#include "ProducitonRule.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Earley recognizer over rules as they are written: no Chomsky normal form is needed, unit rules and epsilon rules (A->@) are allowed.
+//Epsilon rules are handled as in Aycock & Horspool: when a nullable non-terminal is predicted the dot is also moved over it,
+//so completion never has to look at the set which is being built.
+//Every finished item set keeps its items indexed by the non-terminal after the dot, so completion only visits items that can advance.
+//Right recursion is handled as in Leo (1991): if set i has exactly one item A->x.B waiting for B, completing B from i only adds
+//the topmost item of the chain of such items (a transitive item, kept per set) instead of every item of the chain, so
+//recognition is linear on LR-regular grammars, i.e. S->aS | a. Items of the chain are not kept, so acceptance is checked on
+//an added rule S'->S whose non-terminal S' nothing waits for.
+class EarleyRecognizer {
+private:
+	struct Item {
+		unsigned rule;
+		unsigned dot;
+		unsigned origin;
+	};
+	//Items of one set and index of those waiting for a non-terminal
+	struct ItemSet {
+		std::vector<Item> items;
+		std::unordered_map<symbol, std::vector<unsigned> > waiting; //key: non-terminal after dot, value: indices of items
+		std::unordered_map<symbol, Item> transitive; //Leo items found so far, rule NO_RULE if completing the key is not deterministic
+	};
+	static const unsigned NO_RULE = 0xFFFFFFFFu;
+
+	symbol startSymbol;
+	symbol root;							//S' of the added rule S'->S, NO_SYMBOL if grammar has no valid starting symbol
+	std::vector<symbol> lhs;				//lhs[r] is non-terminal of rule r
+	std::vector<unsigned> productStart;		//product of rule r is products[productStart[r] .. productStart[r + 1])
+	std::vector<symbol> products;			//@ is dropped so epsilon rules have empty product
+	std::vector<unsigned> rulesStart;		//rules of non-terminal A are ruleIndex[rulesStart[A] .. rulesStart[A + 1])
+	std::vector<unsigned> ruleIndex;
+	std::vector<bool> nullable;
+
+	unsigned productLength(unsigned rule) const { return productStart[rule + 1] - productStart[rule]; }
+	symbol afterDot(const Item& item) const { return products[productStart[item.rule] + item.dot]; }
+	//Leo item for completing nt from set origin of sets, false if there is none
+	bool transitiveItem(std::vector<ItemSet>& sets, unsigned origin, symbol nt, Item& top) const;
+	//recognized, if not nullptr, is called with (i, j) whenever word[i..j) is recognized. Starting symbol is only predicted at
+	//position 0 unless everyOrigin is set, then it is predicted at every position. Every S'->.S then waits next to the items of
+	//right recursion of S, so those chains are walked - all n^2 spans may be recognized anyway.
+	bool run(const std::string& word, bool everyOrigin, const std::function<void(unsigned, unsigned)>* recognized) const;
+public:
+	EarleyRecognizer(const RuleStore& rules, unsigned nonTerminalCount, symbol startSymbol);
+
+	size_t memoryBytes() const;
+
+	bool recognize(const std::string& word) const;
+	//Element j is 1 iff first j letters of word are recognized. One pass over word, so all prefixes cost as much as the word.
+	std::vector<char> acceptedPrefixes(const std::string& word) const;
+	//Calls found(i, j) for every recognized subword word[i..j), possibly more than once. One pass in which the starting symbol
+	//is predicted at every position, so items of all n + 1 origins share the sets instead of one pass per start position.
+	void acceptedSpans(const std::string& word, const std::function<void(unsigned, unsigned)>& found) const;
+};
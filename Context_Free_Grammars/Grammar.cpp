@@ -1,33 +1,14 @@
 #include "Grammar.h"
-
-const unsigned ENGLISH_ALPHABET_COUNT = 26;
-const unsigned MAX_INDEX_FOR_NT = 1024;
-
-const string BLACK_TEXT = "\x1B[30m";
-const string RED_TEXT = "\x1B[31m";
-const string GREEN_TEXT = "\x1B[32m";
-const string YELLOW_TEXT = "\x1B[33m";
-const string BLUE_TEXT = "\x1B[34m";
-const string MAGENTA_TEXT = "\x1B[35m";
-const string CYAN_TEXT = "\x1B[36m";
-const string WHITE_TEXT = "\x1B[37m";
-const string BRIGHT_BLACK_TEXT = "\x1B[90m";
-const string BRIGHT_RED_TEXT = "\x1B[91m";
-const string BRIGHT_GREEN_TEXT = "\x1B[92m";
-const string BRIGHT_YELLOW_TEXT = "\x1B[93m";
-const string BRIGHT_BLUE_TEXT = "\x1B[94m";
-const string BRIGHT_MAGENTA_TEXT = "\x1B[95m";
-const string BRIGHT_CYAN_TEXT = "\x1B[96m";
-const string BRIGHT_WHITE_TEXT = "\x1B[97m";
-const string RESET_COLORING = "\033[0m";
-
-bool stringOccursInVector(const vector<string>& vec,const string& str) {
-	bool isFound = false;
-	for (auto vit = vec.cbegin();!isFound && vit != vec.cend(); vit++) {
-		isFound = (*vit) == str;
-	}
-	return isFound;
-}
+#include <cstring>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <chrono>
+#include <random>
 
 bool Grammar::isTerminal(const char c) const {
 	return isSmallLetter(c) || isDigit(c) ||  (c == '@');
@@ -56,7 +37,7 @@ bool Grammar::isNonTerminal(const string& s) const {
 
 bool Grammar::isTerminalSet(const terminalSet& a) const {
 	if (a.size() == 0) {
-		cerr << RED_TEXT << "Attempt to create grammar with empty terminal set!" << RESET_COLORING << endl;
+		cerr << RED_TEXT << "Attempt to create grammar with empty terminal set!" << RESET_COLORING << '\n';
 		assert(false);
 	}
 	bool isValid = true;
@@ -68,7 +49,7 @@ bool Grammar::isTerminalSet(const terminalSet& a) const {
 
 bool Grammar::isNonTerminalSet(const nonTerminalSet& a) const {
 	if (a.size() == 0) {
-		cerr << RED_TEXT << "Attempt to create grammar with empty non-terminal set!" << RESET_COLORING << endl;
+		cerr << RED_TEXT << "Attempt to create grammar with empty non-terminal set!" << RESET_COLORING << '\n';
 		assert(false);
 	}
 	bool isValid = true;
@@ -82,18 +63,20 @@ bool Grammar::isNonTerminalSet(const nonTerminalSet& a) const {
 bool Grammar::isExistingTerminal(const char &t) const {
 	if (t == '@')
 		return true;
-	bool isTerminal = false; 
-	terminalSet::const_iterator it= terminals.begin();
-	while (!isTerminal && (it != terminals.end())) {
-		isTerminal = (t == *it);
-		it++;
-	}
-	return isTerminal;
+	return terminalLookup[static_cast<unsigned char>(t)];
 }
 
 //Existing not-terminal = terminal from current set of terminals
 bool Grammar::isExistingNonTerminal(const string& nt) const {
-	return stringOccursInVector(nonTerminals, nt);
+	return nonTerminals.contains(nt);
+}
+
+bool Grammar::isExistingNonTerminal(symbol nt) const {
+	return !isTerminalSymbol(nt) && nt < nonTerminals.size();
+}
+
+bool Grammar::isExistingSymbol(symbol s) const {
+	return isTerminalSymbol(s) ? isExistingTerminal(terminalOf(s)) : isExistingNonTerminal(s);
 }
 
 //Cheks whether NT is of current set and product consists of NT/Ts of current set. Rules which look like A->A are useless and considered invalid.
@@ -102,21 +85,65 @@ bool Grammar::isValidProductionRule(const ProductionRule &rule) const {
 	bool validProduct = rule.product.size() > 0;
 	if (rule.product.size() == 1 && (rule.nonTerminal == rule.product[0]))
 		return false;
-	for (const auto& it : rule.product) {
-			validProduct = isExistingTerminal(it[0]) || isExistingNonTerminal(it);
-		
+	for (auto it = rule.product.cbegin(); validProduct && it != rule.product.cend(); it++) {
+		validProduct = isExistingSymbol(*it);
 	}
 	return validNonTerminal && validProduct;
 }
 
 //Returns number of rules which start with given nonterminal
-unsigned Grammar::rulesOfNonTerminalCount(const string& s) const {
-	unsigned count = 0;
-	for (productions::const_iterator it = rules.begin(); it != rules.end(); it++) {
-		if ((*it).nonTerminal == s)
-			count++;
+unsigned Grammar::rulesOfNonTerminalCount(symbol nt) const {
+	return compile().rulesOfCount(nt);
+}
+
+const CompiledGrammar& Grammar::compile() const {
+	if (!compiled)
+		compiled = std::make_shared<const CompiledGrammar>(rules, nonTerminals.size(), startSymbol);
+	return *compiled;
+}
+
+//Textual name of symbol. Only used when grammar is printed or saved.
+string Grammar::symbolName(symbol s) const {
+	if (isTerminalSymbol(s))
+		return string(1, terminalOf(s));
+	return nonTerminals[s];
+}
+
+//Shortest text which reads back as the same weight
+static string weightText(double weight) {
+	char text[32];
+	std::snprintf(text, sizeof(text), "%.15g", weight);
+	if (std::strtod(text, nullptr) != weight)
+		std::snprintf(text, sizeof(text), "%.17g", weight);
+	return text;
+}
+
+//Accepts whole text as a finite number > 0
+static bool validWeight(double weight) {
+	return std::isfinite(weight) && weight > 0;
+}
+
+static bool parseWeight(const string& text, double& weight) {
+	if (text.empty() || text[0] == ' ')
+		return false;
+	char* end;
+	weight = std::strtod(text.c_str(), &end);
+	return end == text.c_str() + text.size() && validWeight(weight);
+}
+
+//Weight is written only if it is not 1, i.e. "A->BC 0.25"
+void Grammar::printRule(std::ostream& os, const ProductionRule& rule) const {
+	os << nonTerminals[rule.nonTerminal] << "->";
+	for (auto p : rule.product) {
+		os << symbolName(p);
 	}
-	return count;
+	if (rule.weight != 1.0)
+		os << ' ' << weightText(rule.weight);
+}
+
+void Grammar::addTerminal(char t) {
+	terminals.push_back(t);
+	terminalLookup.set(static_cast<unsigned char>(t));
 }
 
 string Grammar::createIndexedNonTerminal(char letter, unsigned index) const {
@@ -128,22 +155,23 @@ string Grammar::createIndexedNonTerminal(char letter, unsigned index) const {
 	return result;
 }
 
+//Counters only move past names which are taken, so producing k names costs O(k) hash lookups in total and there is no upper bound.
 string Grammar::generateNonTerminalName(char prefLetter) const {
 	string newNonTerminal;
-	if (prefLetter && !isDigit(prefLetter)) {
-		if (isSmallLetter(prefLetter)) {
-			prefLetter -= 32;
-		}
+	if (isSmallLetter(prefLetter)) {
+		prefLetter -= 32;
+	}
+	if (isCapitalLetter(prefLetter)) {
 		newNonTerminal = prefLetter;
 		if (!isExistingNonTerminal(newNonTerminal)) {
 			return newNonTerminal;
 		}
-		else {
-			for (unsigned i = 1; i <= MAX_INDEX_FOR_NT * 4; i++) { //since function has been called with preference index cap becomes 4096
-				newNonTerminal = createIndexedNonTerminal(prefLetter, i);
-				if (!isExistingNonTerminal(newNonTerminal))
-					return newNonTerminal;
-			}
+		unsigned& index = nextIndexOfLetter[prefLetter - 'A'];
+		while (true) {
+			newNonTerminal = createIndexedNonTerminal(prefLetter, index);
+			if (!isExistingNonTerminal(newNonTerminal))
+				return newNonTerminal;
+			index++;
 		}
 	}
 	/*
@@ -151,27 +179,26 @@ string Grammar::generateNonTerminalName(char prefLetter) const {
 	if there is available one. Otherwise it wil return capital letter with smallest index
 	i.e. B_1_ (in case all capital letters are taken and A_1_ is taken)
 	*/
-	for (unsigned i = 0; i < ENGLISH_ALPHABET_COUNT; i++) {
-		newNonTerminal = 'A';
+	for (; nextSingleLetter < ENGLISH_ALPHABET_COUNT; nextSingleLetter++) {
+		newNonTerminal = static_cast<char>('A' + nextSingleLetter);
 		if (!isExistingNonTerminal(newNonTerminal)) {
 			return newNonTerminal;
 		}
-		newNonTerminal[0]++;
 	}
-	for (unsigned i = 1; i <= MAX_INDEX_FOR_NT; i++) {
-		for (int j = 0; j < ENGLISH_ALPHABET_COUNT; j++) {
-			newNonTerminal = createIndexedNonTerminal(('A' + j), i);
-			if (!isExistingNonTerminal(newNonTerminal)) {
-				return newNonTerminal;
-			}
+	while (true) { //A_1_, B_1_, ..., Z_1_, A_2_, ...
+		newNonTerminal = createIndexedNonTerminal('A' + nextIndexedName % ENGLISH_ALPHABET_COUNT, nextIndexedName / ENGLISH_ALPHABET_COUNT + 1);
+		if (!isExistingNonTerminal(newNonTerminal)) {
+			return newNonTerminal;
 		}
+		nextIndexedName++;
 	}
 }
 
 //Adds non-terminals and returns true or returns false if nonterminal has illegal name/already exists.
 bool Grammar::addNonTerminal(string nt) {
 	if (isNonTerminal(nt) && !isExistingNonTerminal(nt)) {
-		nonTerminals.push_back(nt);
+		nonTerminals.intern(nt);
+		invalidate();
 		return true;
 	}
 	else {
@@ -179,566 +206,1097 @@ bool Grammar::addNonTerminal(string nt) {
 	}
 }
 
+//Returns id of existing non-terminal or NO_SYMBOL
+symbol Grammar::nonTerminalId(const string& nt) const {
+	return nonTerminals.find(nt);
+}
+
 bool Grammar::RuleAlreadyExists(const ProductionRule& pr) const{
-	bool alreadyExists = false;
-	for (auto it = rules.cbegin() ; !alreadyExists && it != rules.cend() ; it++) {
-		bool sameProduct = pr.product.size() == (*it).product.size();
-		for (unsigned i = 0; sameProduct && i < pr.product.size(); i++)
-			sameProduct = (pr.product[i] == (*it).product[i]);
-		alreadyExists = sameProduct && (pr.nonTerminal == (*it).nonTerminal);
-	}
-	return alreadyExists;
+	ensureRuleSet();
+	return existingRules.find(pr) != existingRules.end();
+}
+
+void Grammar::ensureRuleSet() const {
+	if (ruleSetValid)
+		return;
+	existingRules.clear();
+	existingRules.reserve(rules.size());
+	existingRules.insert(rules.begin(), rules.end());
+	ruleSetValid = true;
+}
+
+//Adds rule if it does not exist yet. Returns whether it was added.
+bool Grammar::pushRule(const ProductionRule& pr) {
+	ensureRuleSet();
+	if (!existingRules.insert(pr).second)
+		return false;
+	rules.push_back(pr);
+	return true;
 }
 
-//Sorts rules by NT in same order NTs are sorted in NT vector
+//Adds rule which is known not to be in grammar (i.e. its head is a new non-terminal) without building the rule set
+void Grammar::appendNewRule(const ProductionRule& pr) {
+	if (ruleSetValid)
+		existingRules.insert(pr);
+	rules.push_back(pr);
+}
+
+//Needed after rules are changed in place. Set is built again on next duplicate check.
+void Grammar::resetRuleSet() {
+	existingRules.clear();
+	ruleSetValid = false;
+}
+
+//Sorts rules by NT in same order NTs are sorted in NT vector. Rules of same NT keep their order.
 void Grammar::sortRules() {
-	int counter = 0;
-	for (auto& nt : nonTerminals) {
-		for (int i = counter; i < rules.size(); i++) {
-			if (rules[i].nonTerminal == nt) {
-				std::swap(rules[i], rules[counter]);
-				counter++;
-			}
-		}
+	const CompiledGrammar& index = compile();
+	if (index.rulesSorted())
+		return;
+	productions sorted;
+	sorted.reserve(rules.size());
+	for (symbol nt = 0; nt < nonTerminals.size(); nt++) {
+		for (const unsigned* r = index.rulesOfBegin(nt); r != index.rulesOfEnd(nt); r++)
+			sorted.push_back(rules[*r]);
 	}
+	rules.assign(std::move(sorted));
+	invalidate();
 }
 
-Grammar::Grammar(): nonTerminals(), terminals(), rules(), startSymbol(), Identidied() {}
+//Returns copy of rule with its non-terminals replaced by their ids in renamed (index: old id, value: new id). Terminals are kept.
+ProductionRule Grammar::renamedRule(const ProductionRule& rule, const vector<symbol>& renamed) const {
+	ProductionRule temp = { renamed[rule.nonTerminal], rule.product, rule.weight };
+	for (auto& p : temp.product) {
+		if (!isTerminalSymbol(p))
+			p = renamed[p];
+	}
+	return temp;
+}
+
+Grammar::Grammar(): Identidied(), nonTerminals(), terminals(), terminalLookup(), rules(), existingRules(), ruleSetValid(true), startSymbol(NO_SYMBOL), compiled(), lastForest(),
+	nextIndexOfLetter(), nextSingleLetter(0), nextIndexedName(0) {
+	nextIndexOfLetter.fill(1);
+}
 
 Grammar::Grammar(nonTerminalSet nonTerminals, terminalSet terminals, productions rules, string startSymbol, unsigned id) :
-	nonTerminals(nonTerminals), terminals(terminals), rules(rules), startSymbol(startSymbol), Identidied(id) {
+	Identidied(id), nonTerminals(), terminals(), terminalLookup(), rules(), existingRules(), ruleSetValid(true), startSymbol(NO_SYMBOL), compiled(), lastForest(),
+	nextIndexOfLetter(), nextSingleLetter(0), nextIndexedName(0) {
+	nextIndexOfLetter.fill(1);
 	if (!isNonTerminalSet(nonTerminals)) {
-		cerr << RED_TEXT << "Attempt to create grammar with invalid non-terminal set!" << RESET_COLORING << endl;
+		cerr << RED_TEXT << "Attempt to create grammar with invalid non-terminal set!" << RESET_COLORING << '\n';
 		assert(false);
 	}
 	if (!isTerminalSet(terminals)) {
-		cerr << RED_TEXT << "Attempt to create grammar with ivalid terminal set!" << RESET_COLORING << endl;
+		cerr << RED_TEXT << "Attempt to create grammar with ivalid terminal set!" << RESET_COLORING << '\n';
 		assert(false);
 	}
+	for (const auto& nt : nonTerminals) {
+		this->nonTerminals.intern(nt);
+	}
+	for (const char t : terminals) {
+		addTerminal(t);
+	}
 	unsigned rulesCount = rules.size();
 	for (unsigned i = 0; i < rulesCount; i++) {
 		if (!isValidProductionRule(rules[i])) {
-			cerr << RED_TEXT << "Attempt to create grammar with invalid production rule '" <<rules[i].nonTerminal << "->" << "\033[0m";
-			for (auto& rp : rules[i].product) { //print product which is vector of string
-				cerr << RED_TEXT << rp << RESET_COLORING;
-			}
-			cerr << RED_TEXT << "'!" << RESET_COLORING << endl;
+			cerr << RED_TEXT << "Attempt to create grammar with invalid production rule '";
+			printRule(cerr, rules[i]);
+			cerr << "'!" << RESET_COLORING << '\n';
 			assert(false);
 		}
+		pushRule(rules[i]); //duplicates are dropped
 	}
-	if (!isExistingNonTerminal(startSymbol)) {
-		cerr << RED_TEXT << "Attempt to create grammar with invalid starting symbol!" << RESET_COLORING << endl;
+	this->startSymbol = nonTerminalId(startSymbol);
+	if (this->startSymbol == NO_SYMBOL) {
+		cerr << RED_TEXT << "Attempt to create grammar with invalid starting symbol!" << RESET_COLORING << '\n';
 		assert(false);
 	}
 }
 
-Grammar::Grammar(const Grammar& other) : nonTerminals(), terminals(), rules(), startSymbol(), Identidied() {
+//Copy shares non-terminal names and chunks of rules with other, so it costs O(number of chunks)
+Grammar::Grammar(const Grammar& other) : Identidied(), nonTerminals(), terminals(), terminalLookup(), rules(), existingRules(), ruleSetValid(false), startSymbol(NO_SYMBOL), compiled(), lastForest(),
+	nextIndexOfLetter(other.nextIndexOfLetter), nextSingleLetter(other.nextSingleLetter), nextIndexedName(other.nextIndexedName) {
 		this->nonTerminals = other.nonTerminals;
 		this->terminals = other.terminals;
+		this->terminalLookup = other.terminalLookup;
 		this->rules = other.rules;
 		this->startSymbol = other.startSymbol;
+		this->compiled = other.compiled; //snapshot is immutable and can be shared
+		this->lastForest = other.lastForest;
 		this->id = other.id;
 }
 
+//Flattens a lazy composition in one pass. Non-terminals get the ids of the composition's id space, so names are the same as
+//if the composition had been built eagerly: names of later operands which are already used get a fresh name.
+Grammar::Grammar(const Composition& composition) : Grammar() {
+	for (char t : composition.firstLeaf().terminals)
+		addTerminal(t);
+	nonTerminals.reserve(composition.nonTerminalCount());
+	rules.reserve(composition.ruleCount());
+	existingRules.reserve(composition.ruleCount());
+	startSymbol = appendComposition(composition);
+}
+
+//Adds non-terminals and rules of node, returns its starting symbol
+symbol Grammar::appendComposition(const Composition& node) {
+	const unsigned first = nonTerminals.size();
+	symbol start;
+	if (node.kind() == Composition::Kind::LEAF) {
+		const Grammar& other = node.leafGrammar();
+		vector<symbol> renamedArr(other.nonTerminals.size());
+		for (symbol nt = 0; nt < other.nonTerminals.size(); nt++) {
+			const string& name = other.nonTerminals[nt];
+			if (!addNonTerminal(name)) {
+				string second = generateNonTerminalName(name[0]);
+				addNonTerminal(second);
+				renamedArr[nt] = nonTerminalId(second);
+				cout << CYAN_TEXT << "\tInfo: Non-terminal " << name << " of Grammar<" << other.id << "> was renamed to " << second << RESET_COLORING << '\n';
+			}
+			else {
+				renamedArr[nt] = nonTerminalId(name);
+			}
+		}
+		for (auto it = other.rules.cbegin(); it != other.rules.cend(); it++)
+			appendNewRule(other.renamedRule(*it, renamedArr)); //heads are new NTs, so rules cannot be duplicates
+		start = renamedArr[other.startSymbol];
+	}
+	else {
+		vector<symbol> starts;
+		for (const auto& operand : node.operands())
+			starts.push_back(appendComposition(*operand));
+		string startingNonTerminal = generateNonTerminalName('S');
+		addNonTerminal(startingNonTerminal);
+		start = nonTerminalId(startingNonTerminal);
+		switch (node.kind()) {
+		case Composition::Kind::UNION:
+			for (symbol s : starts)
+				appendNewRule({ start, { s } });
+			break;
+		case Composition::Kind::CONCAT:
+			appendNewRule({ start, starts });
+			break;
+		default:
+			appendNewRule({ start, { EPSILON_SYMBOL } });
+			appendNewRule({ start, { starts[0], start } });
+			break;
+		}
+	}
+	assert(nonTerminals.size() == first + node.nonTerminalCount());
+	invalidate();
+	return start;
+}
+
+//Moved-from grammar is left empty
+Grammar::Grammar(Grammar&& other) noexcept : Identidied(other.id), nonTerminals(std::move(other.nonTerminals)), terminals(std::move(other.terminals)),
+	terminalLookup(other.terminalLookup), rules(std::move(other.rules)), existingRules(std::move(other.existingRules)), ruleSetValid(other.ruleSetValid),
+	startSymbol(other.startSymbol), compiled(std::move(other.compiled)), lastForest(std::move(other.lastForest)), nextIndexOfLetter(other.nextIndexOfLetter),
+	nextSingleLetter(other.nextSingleLetter), nextIndexedName(other.nextIndexedName) {
+	other.existingRules.clear();
+	other.ruleSetValid = true;
+	other.startSymbol = NO_SYMBOL;
+}
+
 Grammar& Grammar::operator=(const Grammar& other) {
 	if (this != &other) {
 		this->nonTerminals = other.nonTerminals;
 		this->terminals = other.terminals;
+		this->terminalLookup = other.terminalLookup;
 		this->rules = other.rules;
+		this->resetRuleSet();
 		this->startSymbol = other.startSymbol;
+		this->compiled = other.compiled;
+		this->lastForest = other.lastForest;
+		this->nextIndexOfLetter = other.nextIndexOfLetter;
+		this->nextSingleLetter = other.nextSingleLetter;
+		this->nextIndexedName = other.nextIndexedName;
 		this->id = other.id;
 	}
 	return *this;
 }
 
-Grammar& Grammar::Union(const Grammar& other) const {
-
-	//Check if grammars have same terminal sets. If not, operation cannot be performed. 
-	//Assertion is made by checking whether number of Ts are same and if every T of the first grammar is found in other grammar.
+Grammar& Grammar::operator=(Grammar&& other) noexcept {
+	if (this != &other) {
+		this->nonTerminals = std::move(other.nonTerminals);
+		this->terminals = std::move(other.terminals);
+		this->terminalLookup = other.terminalLookup;
+		this->rules = std::move(other.rules);
+		this->existingRules = std::move(other.existingRules);
+		this->ruleSetValid = other.ruleSetValid;
+		this->startSymbol = other.startSymbol;
+		this->compiled = std::move(other.compiled);
+		this->lastForest = std::move(other.lastForest);
+		this->nextIndexOfLetter = other.nextIndexOfLetter;
+		this->nextSingleLetter = other.nextSingleLetter;
+		this->nextIndexedName = other.nextIndexedName;
+		this->id = other.id;
+		other.existingRules.clear();
+		other.ruleSetValid = true;
+		other.startSymbol = NO_SYMBOL;
+	}
+	return *this;
+}
 
-	bool correctTerminals = other.terminals.size() == this->terminals.size();
-	for (auto it = this->terminals.cbegin() ;correctTerminals && it != this->terminals.cend(); it++) {
-		for (auto jt = other.terminals.cbegin();!correctTerminals && jt != other.terminals.cend(); jt++) {
-			correctTerminals = (*it == *jt);
+//Returns every pair (A, B), A != B, such that B is reachable from A using only NT->NT rules.
+//Only non-terminals which occur in such rules get an index. The unit-rule graph is condensed into strongly connected
+//components (Tarjan's algorithm) which come out sinks first, so the reachable set of every component is the union of its
+//members and the sets of components it points to - one bitset OR per edge.
+static vector<pair<symbol, symbol> > unitPairs(const RuleStore& rules, unsigned nonTerminalCount) {
+	vector<unsigned> local(nonTerminalCount, NO_SYMBOL); //index of non-terminal in unit graph
+	vector<symbol> global;
+	vector<pair<unsigned, unsigned> > edges;
+	auto localIndex = [&](symbol nt) {
+		if (local[nt] == NO_SYMBOL) {
+			local[nt] = global.size();
+			global.push_back(nt);
 		}
+		return local[nt];
+	};
+	for (const auto& rule : rules) {
+		if (rule.product.size() == 1 && !isTerminalSymbol(rule.product[0]))
+			edges.push_back({ localIndex(rule.nonTerminal), localIndex(rule.product[0]) });
 	}
-	
-	Grammar* unitedGrammar = new Grammar(*this); //Resulting grammar is same as this grammar with added rules of other grammar and additional starting symbol
-	
-	if (!correctTerminals) { //will return empty grammar
-		cerr << RED_TEXT << "Cannot perform 'union' operation on grammars with different terminal sets!" << RESET_COLORING << endl;
-		return *unitedGrammar;
+	const unsigned n = global.size();
+	vector<unsigned> edgesStart(n + 1, 0), targets(edges.size());
+	for (const auto& e : edges)
+		edgesStart[e.first + 1]++;
+	for (unsigned v = 0; v < n; v++)
+		edgesStart[v + 1] += edgesStart[v];
+	{
+		vector<unsigned> next(edgesStart.begin(), edgesStart.end() - 1);
+		for (const auto& e : edges)
+			targets[next[e.first]++] = e.second;
 	}
-	unitedGrammar->id = 0;
 
-	map<string, string> renamedArr; //key: NT, value: NTs new name
-
-	//	The sets of nonterminals of the 2 grammars need to be disjoined. Non-terminals with repeted names will be renamed in new grammar.
-	//	In order to make sure production rules will stay correct we create an array which contains pairs of non-terminals and their new names.
-	
-	for (auto it = other.nonTerminals.cbegin(); it != other.nonTerminals.cend(); it++) { //add second grammar's NTs and rename them if neccessary
-		if (!(*unitedGrammar).addNonTerminal(*it)) { //hover addNonTerminal
-			string second = (*unitedGrammar).generateNonTerminalName((*it)[0]);
-			(*unitedGrammar).addNonTerminal(second);
-			renamedArr.emplace(*it, second);
+	//Iterative Tarjan
+	const unsigned UNVISITED = NO_SYMBOL;
+	vector<unsigned> order(n, UNVISITED), low(n, 0), component(n, UNVISITED);
+	vector<unsigned> stack, callStack, edgeCursor(n, 0);
+	vector<vector<unsigned> > members;
+	unsigned counter = 0;
+	for (unsigned root = 0; root < n; root++) {
+		if (order[root] != UNVISITED)
+			continue;
+		callStack.push_back(root);
+		while (!callStack.empty()) {
+			unsigned v = callStack.back();
+			if (order[v] == UNVISITED) {
+				order[v] = low[v] = counter++;
+				edgeCursor[v] = edgesStart[v];
+				stack.push_back(v);
+			}
+			if (edgeCursor[v] < edgesStart[v + 1]) {
+				unsigned w = targets[edgeCursor[v]++];
+				if (order[w] == UNVISITED)
+					callStack.push_back(w);
+				else if (component[w] == UNVISITED)
+					low[v] = std::min(low[v], order[w]);
+				continue;
+			}
+			callStack.pop_back();
+			if (!callStack.empty())
+				low[callStack.back()] = std::min(low[callStack.back()], low[v]);
+			if (low[v] == order[v]) {
+				members.emplace_back();
+				unsigned w;
+				do {
+					w = stack.back();
+					stack.pop_back();
+					component[w] = members.size() - 1;
+					members.back().push_back(w);
+				} while (w != v);
+			}
 		}
 	}
-	for (auto it = other.rules.cbegin(); it != other.rules.cend(); it++) { //iterate over second grammar's rules and add rules of second grammar
-																		   //to resulting grammar with new names of renamed NTs id any renaming was done.
-		ProductionRule temp = (*it);									   //Every rule is copied to temp and renamed there if neccesary.
-		for (auto jt = renamedArr.begin(); jt != renamedArr.end(); jt++) {
-			if(temp.nonTerminal == (*jt).first)
-				temp.nonTerminal = (*jt).second;
-			for (auto kt = temp.product.begin(); kt != temp.product.end(); kt++) {
-				if ((*kt) == (*jt).first) {
-					*kt = (*jt).second;
-				}
+
+	const unsigned words = bitsetWords(n);
+	vector<bitWord> reach(members.size() * static_cast<size_t>(words), 0);
+	vector<pair<symbol, symbol> > pairs;
+	for (unsigned c = 0; c < members.size(); c++) {
+		bitWord* set = &reach[c * static_cast<size_t>(words)];
+		for (unsigned v : members[c]) {
+			setBit(set, v);
+			for (unsigned e = edgesStart[v]; e < edgesStart[v + 1]; e++) {
+				if (component[targets[e]] != c)
+					orInto(set, &reach[component[targets[e]] * static_cast<size_t>(words)], words);
 			}
 		}
-		(*unitedGrammar).rules.push_back(temp);
-	}
-
-	//Add new starting symbol and its rules as in algorithm
-	string startingNonTerminal = (*unitedGrammar).generateNonTerminalName('S');
-	(*unitedGrammar).addNonTerminal(startingNonTerminal);
-	(*unitedGrammar).startSymbol = startingNonTerminal;
-	ProductionRule temp1 = { startingNonTerminal, {this->startSymbol} };
-	ProductionRule temp2 = { startingNonTerminal, {other.startSymbol} };
-	
-	//Check if second grammar's starting symbol was renamed. 
-	//Only second grammar's symbols are renamed so this verification is not needed for first grammar's starting symbol.
-	
-	for (auto jt = renamedArr.begin(); jt != renamedArr.end(); jt++) {
-		if (other.startSymbol == (*jt).first) {
-			temp2.product[0] = (*jt).second;
-		}
-	}
-	//Print renamed symbols for easier understanding of product grammar
-	for (auto jt = renamedArr.begin(); jt != renamedArr.end(); jt++) {
-		cout << CYAN_TEXT << "\tInfo 'Union': Non-terminal " << (*jt).first << " of Grammar<" << other.id << "> was renamed to " << (*jt).second << RESET_COLORING << endl;
-	}
-	(*unitedGrammar).rules.push_back(temp1);
-	(*unitedGrammar).rules.push_back(temp2);
-	return *unitedGrammar;
-}
-
-Grammar& Grammar::Concat(const Grammar& other) const {
-	bool correctTerminals = other.terminals.size() == this->terminals.size();
-	for (auto it = this->terminals.cbegin(); correctTerminals && it != this->terminals.cend(); it++) {
-		for (auto jt = other.terminals.cbegin(); !correctTerminals && jt != other.terminals.cend(); jt++) {
-			correctTerminals = (*it == *jt);
-		}
-	}
-	Grammar* concatenatedGrammar = new Grammar;
-	if (!correctTerminals) { //will return empty grammar
-		cerr << RED_TEXT << "Cannot perform 'concat' operation on grammars with different terminal sets!" << RESET_COLORING << endl;
-		return *concatenatedGrammar;
-	}
-	*concatenatedGrammar = *this;
-	concatenatedGrammar->id = 0;
-	map<string, string> renamedArr;
-	//	The sets of nonterminals of the 2 grammars need to be disjoined. Non-terminals with repeted names will be renamed in new grammar.
-	//	In order to make sure production rules will stay correct we create and array wich contains pairs of non-terminals and their new names.
-
-	for (auto it = other.nonTerminals.cbegin(); it != other.nonTerminals.cend(); it++) {
-		if (!(*concatenatedGrammar).addNonTerminal(*it)) { //hover addNonTerminal
-			string second = (*concatenatedGrammar).generateNonTerminalName((*it)[0]);
-			(*concatenatedGrammar).addNonTerminal(second);
-			renamedArr.emplace(*it, second);
-		}
-	}
-	for (auto it = other.rules.cbegin(); it != other.rules.cend(); it++) {
-		ProductionRule temp = (*it);
-		for (auto jt = renamedArr.begin(); jt != renamedArr.end(); jt++) {
-			if (temp.nonTerminal == (*jt).first)
-				temp.nonTerminal = (*jt).second;
-			for (auto kt = temp.product.begin(); kt != temp.product.end(); kt++) {
-				if ((*kt) == (*jt).first) {
-					*kt = (*jt).second;
-				}
-			}
+		for (unsigned v : members[c]) {
+			forEachBit(set, words, [&](unsigned w) {
+				if (w != v)
+					pairs.push_back({ global[v], global[w] });
+			});
 		}
-		(*concatenatedGrammar).rules.push_back(temp);
 	}
+	return pairs;
+}
 
-	//So far logic is identical to Union function
-
-	string startingNonTerminal = (*concatenatedGrammar).generateNonTerminalName('S');
-	(*concatenatedGrammar).addNonTerminal(startingNonTerminal);
-	(*concatenatedGrammar).startSymbol = startingNonTerminal;
-	ProductionRule temp1 = { startingNonTerminal, {this->startSymbol, other.startSymbol} };
-	
-	//Check if second grammar's starting symbol was renamed. 
-	//Only second grammar's symbols are renamed so this verification is not needed for first grammar's starting symbol.
+//Weight fixpoints below are found by iteration from 0. They converge for grammars whose weights are probabilities;
+//others stop after this many rounds.
+const unsigned MAX_WEIGHT_ROUNDS = 1000;
+const double WEIGHT_TOLERANCE = 1e-12;
 
-	for (auto jt = renamedArr.begin(); jt != renamedArr.end(); jt++) {
-		if (other.startSymbol == (*jt).first) {
-			temp1.product[1] = (*jt).second;
-		}
+static bool closeWeights(const vector<double>& a, const vector<double>& b) {
+	for (size_t i = 0; i < a.size(); i++) {
+		if (std::fabs(a[i] - b[i]) > WEIGHT_TOLERANCE * std::max(1.0, std::fabs(a[i])))
+			return false;
 	}
-	(*concatenatedGrammar).rules.push_back(temp1);
+	return true;
+}
 
-	//Print renamed symbols for easier understanding of resulting grammar
-	for (auto jt = renamedArr.begin(); jt != renamedArr.end(); jt++) {
-		cout << CYAN_TEXT << "\tInfo 'Concat': Non-terminal " << (*jt).first << " of Grammar<" << other.id << "> was renamed to " << (*jt).second << RESET_COLORING << endl;
+//Total weight of derivations of @ from every non-terminal: e(A) = sum of w * e(X1) * ... * e(Xk) over rules A->X1...Xk (w)
+//which have only nullable non-terminals (or @) in their products
+static vector<double> epsilonWeights(const RuleStore& rules, unsigned ntCount, const vector<bool>& nullable) {
+	vector<unsigned> used;
+	for (unsigned r = 0; r < rules.size(); r++) {
+		bool allNullable = true;
+		for (symbol p : rules[r].product)
+			allNullable = allNullable && (p == EPSILON_SYMBOL || (!isTerminalSymbol(p) && nullable[p]));
+		if (allNullable)
+			used.push_back(r);
+	}
+	vector<double> weight(ntCount, 0.0);
+	for (unsigned round = 0; round < MAX_WEIGHT_ROUNDS; round++) {
+		vector<double> next(ntCount, 0.0);
+		for (unsigned r : used) {
+			double w = rules[r].weight;
+			for (symbol p : rules[r].product) {
+				if (p != EPSILON_SYMBOL)
+					w *= weight[p];
+			}
+			next[rules[r].nonTerminal] += w;
+		}
+		bool stable = closeWeights(next, weight);
+		weight.swap(next);
+		if (stable)
+			break;
 	}
-	return *concatenatedGrammar;
+	return weight;
 }
 
-Grammar& Grammar::Iter() const {
-
-	Grammar* iteratedGrammar = new Grammar(*this); //Iteration basically returns same grammar with several added rules and new starting symbol
-	
-	//Add new NT and rules as in algorithm
-	(*iteratedGrammar).id = 0;
-	string nr = (*iteratedGrammar).generateNonTerminalName('S');
-	(*iteratedGrammar).addNonTerminal(nr);
-	(*iteratedGrammar).startSymbol = nr;
-	ProductionRule p1 = { nr, { "@" } };
-	ProductionRule p2 = { nr, { this->startSymbol, nr } };
-	iteratedGrammar->rules.push_back(p1);
-	iteratedGrammar->rules.push_back(p2);
-
-	return (*iteratedGrammar);
-}
+//Total weight of chains of unit rules A =>+ B (products of weights along a chain, summed over chains) for every pair of
+//unitPairs and for A =>+ A if A is on a cycle, as (A, B, weight). selfLoops[A] is weight of A->A, which grammars do not keep as a rule.
+static vector<tuple<symbol, symbol, double> > unitChainWeights(const RuleStore& rules, unsigned ntCount,
+	const vector<pair<symbol, symbol> >& unitPairs, const vector<double>& selfLoops) {
+	vector<vector<pair<symbol, double> > > edges(ntCount);
+	for (const auto& rule : rules) {
+		if (rule.product.size() == 1 && !isTerminalSymbol(rule.product[0]))
+			edges[rule.nonTerminal].push_back({ rule.product[0], rule.weight });
+	}
+	vector<vector<symbol> > reach(ntCount);
+	for (const auto& unitPair : unitPairs)
+		reach[unitPair.first].push_back(unitPair.second);
+	for (symbol nt = 0; nt < ntCount; nt++) {
+		if (selfLoops[nt] > 0)
+			edges[nt].push_back({ nt, selfLoops[nt] });
+	}
 
-bool Grammar::Chomsky() const {
-	bool isChomskyfied = true;
-	for (auto it = rules.cbegin();isChomskyfied && it != rules.cend(); it++) { //In CNF rules' products' lenghts are 1 or 2
-		if ((*it).product.size() == 1) { 
-			if ((*it).product[0] == "@") { //if epsilon rule exists it needs to be form the starting symbol
-				isChomskyfied = this->startSymbol == (*it).nonTerminal;
+	vector<tuple<symbol, symbol, double> > chains;
+	vector<double> chain(ntCount, 0.0), next(ntCount, 0.0);
+	for (symbol from = 0; from < ntCount; from++) {
+		if (edges[from].empty())
+			continue;
+		vector<symbol>& targets = reach[from];
+		targets.push_back(from);
+		//chain(B) = W(from, B) + sum of chain(C) * W(C, B)
+		for (unsigned round = 0; round < MAX_WEIGHT_ROUNDS; round++) {
+			for (symbol b : targets)
+				next[b] = 0.0;
+			for (const auto& edge : edges[from])
+				next[edge.first] += edge.second;
+			for (symbol c : targets) {
+				if (chain[c] == 0.0)
+					continue;
+				for (const auto& edge : edges[c])
+					next[edge.first] += chain[c] * edge.second;
+			}
+			bool stable = true;
+			for (symbol b : targets) {
+				stable = stable && std::fabs(next[b] - chain[b]) <= WEIGHT_TOLERANCE * std::max(1.0, std::fabs(next[b]));
+				chain[b] = next[b];
 			}
-			isChomskyfied = isExistingTerminal((*it).product[0][0]); //If product has lenght 1 it needs to be a terminal
+			if (stable)
+				break;
 		}
-		else if ((*it).product.size() == 2) { //If product has lenght 1 it needs to be a terminal
-			isChomskyfied = isExistingNonTerminal((*it).product[0]);
-			isChomskyfied = isExistingNonTerminal((*it).product[1]);
+		for (symbol b : targets) {
+			if (chain[b] > 0)
+				chains.emplace_back(from, b, chain[b]);
+			chain[b] = 0.0;
 		}
-		else
-			isChomskyfied = false;
 	}
-	return isChomskyfied;
+	return chains;
 }
 
+bool Grammar::Chomsky() const {
+	//In CNF rules' products are a terminal, two non-terminals or @ from the starting symbol - check CompiledGrammar
+	return compile().isChomsky();
+}
+
+bool Grammar::isWeighted() const {
+	for (const auto& rule : rules) {
+		if (rule.weight != 1.0)
+			return true;
+	}
+	return false;
+}
+
+//Weights are carried so that every word keeps its total weight (sum over its trees of product of weights of their rules):
+//new rules of long products get weight 1, a rule which stands for a part of a derivation gets the weight of that part and
+//weights of rules which come out equal are added up.
 void Grammar::Chomskify() {
-	std::map<char, string> generatedNonTerminals;					// key: terminal , value: generated nonterminal
+	invalidate();
+	const bool weighted = isWeighted();
+	std::unordered_map<ProductionRule, unsigned, ProductionRuleHash> ruleAt; //index of every rule, only kept for weighted grammars
+	auto indexRules = [&]() {
+		ruleAt.clear();
+		for (unsigned i = 0; weighted && i < rules.size(); i++)
+			ruleAt.emplace(rules[i], i);
+	};
+	auto mergeRule = [&](const ProductionRule& rule) {
+		if (pushRule(rule)) {
+			if (weighted)
+				ruleAt.emplace(rule, rules.size() - 1);
+		}
+		else if (weighted) {
+			rules.modify(ruleAt[rule]).weight += rule.weight;
+		}
+	};
+	std::map<char, symbol> generatedNonTerminals;					// key: terminal , value: generated nonterminal
 
 	//Remove rules with productions of terminals and nonterminals. 
 	for (unsigned i = 0; i < rules.size(); i++) {
-		for (auto& jt : rules[i].product) {
-			if (rules[i].product.size() > 1) {
-				if (isExistingTerminal(jt[0])) {	// current product has size >=2 -> every terminal needs to be replaced with newly generated non-terminal
-					string newNt;
-					std::map<char, string>::iterator mapIterator;		//check if such nonTerminal has already been generated to avoid creating useless NTs
-					mapIterator = generatedNonTerminals.find(jt[0]);
+		if (rules[i].product.size() > 1) {
+			for (unsigned j = 0; j < rules[i].product.size(); j++) {
+				symbol jt = rules[i].product[j];
+				if (isTerminalSymbol(jt)) {	// current product has size >=2 -> every terminal needs to be replaced with newly generated non-terminal
+					symbol newNt;
+					std::map<char, symbol>::iterator mapIterator;		//check if such nonTerminal has already been generated to avoid creating useless NTs
+					mapIterator = generatedNonTerminals.find(terminalOf(jt));
 					if (mapIterator == generatedNonTerminals.end()) {   //if not create NT
-						newNt = generateNonTerminalName(jt[0]);
-						addNonTerminal(newNt);
+						string newName = generateNonTerminalName(terminalOf(jt));
+						addNonTerminal(newName);
+						newNt = nonTerminalId(newName);
 						ProductionRule newRule = { newNt, {jt} };	// create new NT->T rule (e.g. D->d)
-						if (!RuleAlreadyExists(newRule) && isValidProductionRule(newRule))
-							rules.push_back(newRule);
+						if (isValidProductionRule(newRule))
+							pushRule(newRule);
 
-						generatedNonTerminals.emplace(jt[0], newNt);	//replace T with new NT
+						generatedNonTerminals.emplace(terminalOf(jt), newNt);	//replace T with new NT
 					}
 					else {
 						newNt = (*mapIterator).second;
 					}
-					jt.assign(newNt);
+					rules.modify(i).product[j] = newNt;
 				}
 			}
 		}
 	}
 
-	//Remove long rules		
-	for (unsigned i = 0; i < rules.size(); i++) {
+	//Remove long rules (A->X1X2...Xk becomes A->X1A1, A1->X2A2, ..., Ak-2->Xk-1Xk)
+	unsigned longRulesCount = rules.size();
+	for (unsigned i = 0; i < longRulesCount; i++) {
 		if (rules[i].product.size() > 2) {
-			//Save odd part in new vector
-			vector<string> oddNonTermials;
-			vector<string>::const_iterator start = rules[i].product.begin() + 1;
-			vector<string>::const_iterator end = rules[i].product.end();
-			oddNonTermials.assign(start, end);
-
-			//Remove odd part from current product
-			rules[i].product.erase(start, end);
+			vector<symbol> product = std::move(rules.modify(i).product);
 
 			//Generate new NT for odd part and add rule with it
-			string newNt = generateNonTerminalName();
-			addNonTerminal(newNt);
-			rules[i].product.push_back(newNt);
-
-			ProductionRule tempRule = { newNt, oddNonTermials };
-			if (!RuleAlreadyExists(tempRule) && isValidProductionRule(tempRule))
-				rules.push_back(tempRule);
+			string newName = generateNonTerminalName();
+			addNonTerminal(newName);
+			symbol newNt = nonTerminalId(newName);
+			rules.modify(i).product = { product[0], newNt };
+
+			for (unsigned j = 1; j + 2 < product.size(); j++) {
+				newName = generateNonTerminalName();
+				addNonTerminal(newName);
+				symbol nextNt = nonTerminalId(newName);
+				pushRule({ newNt, { product[j], nextNt } });
+				newNt = nextNt;
+			}
+			pushRule({ newNt, { product[product.size() - 2], product.back() } });
 		}
 	}
 
+	resetRuleSet(); //products above were changed in place
+
 	//Remove epsilon rules
-	vector<string> epsilonNT;	//Contains every nonterinal which can be directly or indirectly be repaced with @
+	vector<bool> epsilonNT = nullableNonTerminals(rules, nonTerminals.size());	//epsilonNT[nt] is true if nonterinal can be directly or indirectly be repaced with @
+	vector<double> epsilonWeight = weighted ? epsilonWeights(rules, nonTerminals.size(), epsilonNT) : vector<double>();
+	vector<double> selfLoops(nonTerminals.size(), 0.0);	//weight of A->A copies, which are not kept as rules
 
-	bool epsilonFromStartNeeded = false; //If any epsilon rule is not deleted logic in next algorithm breaks. 
+	bool epsilonFromStartNeeded = epsilonNT[startSymbol]; //If any epsilon rule is not deleted logic in next algorithm breaks. 
 										 //Since CNF allows epsilon rule from starting symbol it will be deleted and then added at the end of the funciton if neccesary.
-	///Check for direct @ productions and add to array (e.g A->@)
-	for (unsigned i = 0; i < rules.size(); i++) {
-		if ((rules[i].product.size() == 1) && (rules[i].product[0] == "@")) {
-			epsilonNT.push_back(rules[i].nonTerminal);
-			epsilonFromStartNeeded = rules[i].nonTerminal == this->startSymbol;		//If S->@ existed then add it at the end
-			std::vector<ProductionRule>::iterator tempIt = rules.begin() + i;
-			rules.erase(tempIt);
-			i--; //one rule is erased
-			
-		}
-	}
-
-	///Check for indirect @ productions and add to array (e.g. A->B B->@)
-	bool addedTerminal = false;
-	do {
-		addedTerminal = false; //if this flag becomes true epsilonNT now has new elements and iteration needs to be executed again
-		for (auto it = rules.cbegin(); it != rules.cend(); it++) {
-			bool isEpsilonNt = true;
-			for (auto jt : (*it).product) { //check if product consists of only epsilonNTs. If so then current rule's NT is epsilon NT.
-				bool currentIsEpsilonNt = stringOccursInVector(epsilonNT, jt);
-				if (!currentIsEpsilonNt) {
-					isEpsilonNt = false;
-				}
-			}
-			if (isEpsilonNt) {
-				bool alreadyExists = stringOccursInVector(epsilonNT, (*it).nonTerminal);
-				if (!alreadyExists) {
-					if ((*it).nonTerminal == this->startSymbol)
-						epsilonFromStartNeeded = true;
-					epsilonNT.push_back((*it).nonTerminal);
-					addedTerminal = true;
-				}
-			}
-		}
-	} while (addedTerminal);
-
-	bool addedRule;
+	rules.removeIf([](const ProductionRule& rule) {
+		return rule.product.size() == 1 && rule.product[0] == EPSILON_SYMBOL;
+	});
+	for (symbol nt = 0; nt < nonTerminals.size(); nt++) {
+		if (epsilonNT[nt])
+			existingRules.erase({ nt, { EPSILON_SYMBOL } });
+	}
 
-	do {
-		addedRule = false;
-		for (const auto& rule : rules) { //Iterate through all the rules to add new ones as in algorithm
-			for (unsigned j = 0; j < rule.product.size(); j++) {
-				bool isEpsilonNt = false;
-				for (auto kt = epsilonNT.cbegin(); !isEpsilonNt && kt != epsilonNT.cend(); kt++) {
-					isEpsilonNt = rule.product[j] == (*kt); //If any of product parts is epsilon NT then new rule should be added.
-				}
-				if (isEpsilonNt) {  //Add new rule with same product omitting current epsilon NT
-					vector<string> tempProduct = rule.product;
-					vector<string>::iterator tempIt = tempProduct.begin();
-					tempIt += j;
-					tempProduct.erase(tempIt);
-					ProductionRule tempRule = { rule.nonTerminal, tempProduct };
-					if (!RuleAlreadyExists(tempRule) && isValidProductionRule(tempRule)) {
-						rules.push_back(tempRule);
-						addedRule = true;
+	///Every rule gets a copy for every subset of its epsilon NTs omitted (e.g. A->BC with B,C epsilon NTs gives A->C, A->B).
+	///Products are at most 2 long here so a rule has at most 3 new copies and one pass is enough.
+	///A copy weighs as much as the rule times weights of @ from the omitted NTs. Kept NTs now only derive non-empty words, so the rule keeps its weight.
+	indexRules();
+	unsigned rulesCount = rules.size();
+	vector<ProductionRule> copies;
+	for (unsigned i = 0; i < rulesCount; i++) {
+		vector<unsigned> epsilonPositions;
+		for (unsigned j = 0; j < rules[i].product.size(); j++) {
+			if (!isTerminalSymbol(rules[i].product[j]) && epsilonNT[rules[i].product[j]])
+				epsilonPositions.push_back(j);
+		}
+		for (unsigned omitted = 1; omitted < (1u << epsilonPositions.size()); omitted++) {
+			ProductionRule tempRule = { rules[i].nonTerminal, {}, rules[i].weight };
+			for (unsigned j = 0, e = 0; j < rules[i].product.size(); j++) {
+				if (e < epsilonPositions.size() && epsilonPositions[e] == j) {
+					if ((omitted >> e++) & 1) {
+						if (weighted)
+							tempRule.weight *= epsilonWeight[rules[i].product[j]];
+						continue;
 					}
 				}
+				tempRule.product.push_back(rules[i].product[j]);
 			}
+			if (isValidProductionRule(tempRule))
+				copies.push_back(std::move(tempRule));
+			else if (weighted && tempRule.product.size() == 1 && tempRule.product[0] == tempRule.nonTerminal)
+				selfLoops[tempRule.nonTerminal] += tempRule.weight;
 		}
-	} while (addedRule); //New rules could also have epsilon NTs in them if initial product had rule where NT goes to 2 or more epsilonNTs
+	}
+	for (const auto& copy : copies)
+		mergeRule(copy);
 
 	//Remove Non-terminal -> Non-terminal rules
-	//Algorithm: Remove every NT1 -> NT2 rule and add rules NT1 -> P where P is product of NT2 rule
-
-	vector<pair<string, string> > tilda; //Set of <NT,NT> pairs. Each pair represents NT->NT rule.
-	vector<ProductionRule> newRules;
-	vector<int> indeciesOfRulesToDelete; 
+	//Algorithm: Remove every NT1 -> NT2 rule and add rules NT1 -> P where P is product of NT2 rule for every NT2 reachable from NT1 by NT->NT rules
+
+	auto isUnitRule = [this](const ProductionRule& rule) { return rule.product.size() == 1 && isExistingNonTerminal(rule.product[0]); };
+	vector<pair<symbol, symbol> > tilda = unitPairs(rules, nonTerminals.size()); //Every pair (NT1, NT2) with NT1 =>* NT2 by NT->NT rules, NT1 != NT2
+
+	///Index rules by NT so that products of NT2 are found directly
+	vector<unsigned> rulesStart(nonTerminals.size() + 1, 0);
+	vector<unsigned> ruleIndex(rules.size());
+	for (const auto& rule : rules)
+		rulesStart[rule.nonTerminal + 1]++;
+	for (symbol nt = 0; nt < nonTerminals.size(); nt++)
+		rulesStart[nt + 1] += rulesStart[nt];
+	{
+		vector<unsigned> next(rulesStart.begin(), rulesStart.end() - 1);
+		for (unsigned i = 0; i < rules.size(); i++)
+			ruleIndex[next[rules[i].nonTerminal]++] = i;
+	}
 
-		///Add to tilda
-	for (int i = 0; i < rules.size(); i++) {
-		if (rules[i].product.size() == 1 && isExistingNonTerminal(rules[i].product[0])) {
-			pair<string, string> temp = { rules[i].nonTerminal, rules[i].product[0] };
-			indeciesOfRulesToDelete.push_back(i); //Current rule is NT->NT and needs to be deleted
-			bool already_exists = false;
-			for (auto& te : tilda) {
-				if (te == temp) {
-					already_exists = true;
-					break;
-				}
-			}
-			if (!already_exists)
-				tilda.push_back(temp);
-		}
-	}
-	
-	bool addedToTilda;
-	do { //Iteration is now over tilda, not over rules
-		vector<pair<string, string> > pairsToAdd; //needed bc cannot iterate over vector and modify it at the same time
-		addedToTilda = false;
-		for (auto& te : tilda) {
-			for (auto& te2 : tilda) {
-				if (te.second == te2.first && te.first != te2.second) { // if (A,B) (B,C) are elements from tilda add (A,C) omitting rules like (A,A)
-					pair<string, string> temp = { te.first, te2.second };
-					bool already_exists = false;
-					for (auto& te3 : tilda) {
-						if (te3 == temp) {
-							already_exists = true;
-							break;
-						}
-					}
-					if (!already_exists)
-						pairsToAdd.push_back(temp);
-				}
-			}
-		}
-		for (auto& pta : pairsToAdd) { //add new elements from temp arr pairsToAdd to tilda
-			tilda.push_back(pta);
-			addedToTilda = true; //tilda now has new NTs and iteration needs to be repeated
-		}
-	} while (addedToTilda);
-
-		///Add new rules to temp vector of rules -- also needed bc cannot iterate and modify vector simultaneously
-	for (const auto& tildaElement : tilda) {
-		for (const auto& currentRule : rules) {
-			if (currentRule.nonTerminal == tildaElement.second) {
-				ProductionRule temp;
-				temp.nonTerminal = tildaElement.first;
-				temp.product = currentRule.product;
-				if (isValidProductionRule(temp) && !RuleAlreadyExists(temp) && !(temp.product.size() == 1 && isExistingNonTerminal(temp.product[0]))) {
-					//Last check is whether rule is not NT -> NT	
-					newRules.push_back(temp);
-				}
-			}
-		}
+	///Weighted grammars also need weights of the chains NT1 =>+ NT2, including cycles back to NT1
+	vector<tuple<symbol, symbol, double> > chains;
+	if (weighted)
+		chains = unitChainWeights(rules, nonTerminals.size(), tilda, selfLoops);
+	else {
+		for (const auto& tildaElement : tilda)
+			chains.emplace_back(tildaElement.first, tildaElement.second, 1.0);
 	}
-		///Push back rules from temp vector to vetor of strings of grammar
-	for (const auto& vectorElement : newRules) {
-		if (!RuleAlreadyExists(vectorElement) && isValidProductionRule(vectorElement)) {
-			rules.push_back(vectorElement);
-		}
 
+	vector<ProductionRule> newRules;
+	for (const auto& chain : chains) {
+		symbol from = std::get<0>(chain), to = std::get<1>(chain);
+		for (unsigned r = rulesStart[to]; r < rulesStart[to + 1]; r++) {
+			const ProductionRule& currentRule = rules[ruleIndex[r]];
+			if (isUnitRule(currentRule))
+				continue;
+			ProductionRule temp = { from, currentRule.product, std::get<2>(chain) * currentRule.weight };
+			if (isValidProductionRule(temp))
+				newRules.push_back(temp);
+		}
 	}
 		///Delete NT -> NT rules
-	for (std::vector<int>::reverse_iterator rit = indeciesOfRulesToDelete.rbegin(); rit != indeciesOfRulesToDelete.rend(); rit++) {
-		auto tempIt = rules.begin() + (*rit);
-		rules.erase(tempIt);
+	rules.removeIf(isUnitRule);
+	for (const auto& tildaElement : tilda)
+		existingRules.erase({ tildaElement.first, { tildaElement.second } });
+		///Push back rules from temp vector to vetor of rules of grammar
+	indexRules();
+	for (const auto& vectorElement : newRules) {
+		mergeRule(vectorElement);
 	}
 
 	//Add S->@ if neccesary where S is starting symbol
 	if (epsilonFromStartNeeded) {
-		ProductionRule serule = { this->startSymbol, {"@"} };
-		rules.push_back(serule);
+		ProductionRule serule = { this->startSymbol, {EPSILON_SYMBOL}, weighted ? epsilonWeight[startSymbol] : 1.0 };
+		pushRule(serule);
+	}
+}
+
+//threads > 1 fills the chart in parallel - check CYKRecognizer
+//Returns nullptr if grammar is not in Chomsky normal form
+std::shared_ptr<const CYKRecognizer> Grammar::cykRecognizer() const {
+	if (!Chomsky()) {
+		cerr << RED_TEXT << "Grammar is not in Chomsky Normal Form. Algorithm CYK cannot be executed.\n" <<
+									"You can use 'chomskify' command to make grammar in Chomsky Normal Form." << RESET_COLORING << '\n';
+		return nullptr;
+	}
+	return compile().cykRecognizer(rules);
+}
+
+bool Grammar::CYK(string word, unsigned threads) const {
+	//Algorithm at page 33 at : https://learn.fmi.uni-sofia.bg/pluginfile.php/193362/mod_resource/content/1/3contextfreegram.pdf
+	//Table is kept as triangular chart of non-terminal bitsets - check CYKRecognizer
+	std::shared_ptr<const CYKRecognizer> recognizer = cykRecognizer();
+	if (!recognizer)
+		return false;
+	bool recognized;
+	if (threads > 1 && word.length() >= PARALLEL_CYK_MIN_LENGTH) {
+		ThreadPool pool(threads);
+		vector<bitWord> chart;
+		recognized = recognizer->recognize(word.data(), word.length(), chart, pool);
 	}
+	else {
+		recognized = recognizer->recognize(word);
+	}
+	if (recognized) {
+		cout << BRIGHT_GREEN_TEXT << "Word '" << word << "' is recognized by Grammar<"<< this->id << ">!" << RESET_COLORING << '\n';
+		return true;
+	}
+	cout << BRIGHT_RED_TEXT << "Word '" << word << "' is NOT recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+	return false;
+}
+
+//Works on rules as they are - grammar does not need to be in Chomsky normal form
+bool Grammar::Earley(string word) const {
+	if (earleyRecognizer().recognize(word)) {
+		cout << BRIGHT_GREEN_TEXT << "Word '" << word << "' is recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+		return true;
+	}
+	cout << BRIGHT_RED_TEXT << "Word '" << word << "' is NOT recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+	return false;
 }
 
-//returns vector of pairs of strings where every string of first vector is related with every string of second vector
-vector<pair <string, string> > crossJoin (const vector<string>& A,const vector<string>& B) { //stackoverflow said return by value
-	vector<pair <string, string> > result;
-	for (unsigned i = 0; i < A.size(); i++) {
-		for (unsigned j = 0; j < B.size(); j++) {
-			pair<string, string> temp = { A[i], B[j] };
-			result.push_back(temp);
+//Forest is kept until grammar changes, so asking for more trees or for the whole forest of the same word does not parse again
+std::shared_ptr<const ParseForest> Grammar::parseForest(const string& word) const {
+	if (!cykRecognizer())
+		return nullptr;
+	if (!lastForest || lastForest->word() != word)
+		lastForest = std::make_shared<const ParseForest>(rules, compile(), word);
+	return lastForest;
+}
+
+//Prints number of parse trees of word and first 'trees' of them
+bool Grammar::Parse(const string& word, unsigned long long trees) const {
+	std::shared_ptr<const ParseForest> forest = parseForest(word);
+	if (!forest)
+		return false;
+	if (!forest->recognized()) {
+		cout << BRIGHT_RED_TEXT << "Word '" << word << "' is NOT recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+		return true;
+	}
+	unsigned long long count = forest->treeCount();
+	cout << BRIGHT_GREEN_TEXT << "Word '" << word << "' has " << (count == ParseForest::MANY_TREES ? "at least " : "") << count << " parse tree(s) in Grammar<"
+		<< this->id << ">! Forest has " << forest->nodeCount() << " nodes and " << forest->packedCount() << " packed nodes." << RESET_COLORING << '\n';
+	auto name = [this](symbol s) { return symbolName(s); };
+	for (unsigned long long i = 0; i < trees && i < count; i++) {
+		cout << CYAN_TEXT << i + 1 << ". " << RESET_COLORING;
+		forest->writeTree(cout, i, name);
+		cout << '\n';
+	}
+	return true;
+}
+
+bool Grammar::PrintForest(const string& word) const {
+	std::shared_ptr<const ParseForest> forest = parseForest(word);
+	if (!forest)
+		return false;
+	if (!forest->recognized()) {
+		cout << BRIGHT_RED_TEXT << "Word '" << word << "' is NOT recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+		return true;
+	}
+	cout << CYAN_TEXT << "Parse forest of '" << word << "' in Grammar<" << this->id << ">: " << forest->nodeCount() << " nodes, " << forest->packedCount()
+		<< " packed nodes" << RESET_COLORING << '\n';
+	forest->writeForest(cout, [this](symbol s) { return symbolName(s); });
+	return true;
+}
+
+//Prints number of parse trees of word and where the ambiguity starts. Count is SaturatingCount or BigCount.
+template <typename Count>
+static void printAmbiguity(const CompiledGrammar& index, const string& word, unsigned id, const std::function<string(symbol)>& name) {
+	DerivationCounts<Count> chart(index, word);
+	Count trees = chart.total();
+	if (trees.isZero()) {
+		cout << BRIGHT_RED_TEXT << "Word '" << word << "' is NOT recognized by Grammar<" << id << ">!" << RESET_COLORING << '\n';
+		return;
+	}
+	if (!trees.moreThanOne()) {
+		cout << BRIGHT_GREEN_TEXT << "Word '" << word << "' has 1 parse tree in Grammar<" << id << "> - it is not ambiguous!" << RESET_COLORING << '\n';
+		return;
+	}
+	cout << BRIGHT_YELLOW_TEXT << "Word '" << word << "' has " << trees.toString() << " parse trees in Grammar<" << id << ">!" << RESET_COLORING << '\n';
+	symbol nt;
+	unsigned start, len;
+	if (chart.smallestAmbiguousSpan(nt, start, len)) {
+		cout << CYAN_TEXT << "Smallest ambiguous span: [" << start << ',' << start + len << ") '" << word.substr(start, len) << "' is derived from "
+			<< name(nt) << " in " << chart.count(nt, start, len).toString() << " ways." << RESET_COLORING << '\n';
+	}
+}
+
+bool Grammar::Ambiguity(const string& word, bool exact) const {
+	if (!cykRecognizer())
+		return false;
+	auto name = [this](symbol s) { return symbolName(s); };
+	if (exact)
+		printAmbiguity<BigCount>(compile(), word, this->id, name);
+	else
+		printAmbiguity<SaturatingCount>(compile(), word, this->id, name);
+	return true;
+}
+
+//Counts parse trees of every word in parallel and prints the 'top' most ambiguous words, most trees first
+bool Grammar::AmbiguityBatch(const vector<TextLine>& words, unsigned top, unsigned threads) const {
+	if (!cykRecognizer())
+		return false;
+	struct Result {
+		SaturatingCount trees;
+		symbol nt;
+		unsigned start;
+		unsigned len;
+	};
+	const CompiledGrammar& index = compile();
+	vector<Result> results(words.size(), { SaturatingCount(), NO_SYMBOL, 0, 0 });
+	ThreadPool pool(threads);
+	pool.parallelFor(0, words.size(), 16, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			DerivationCounts<SaturatingCount> chart(index, string(words[i].data, words[i].length));
+			results[i].trees = chart.total();
+			chart.smallestAmbiguousSpan(results[i].nt, results[i].start, results[i].len);
 		}
+	});
+
+	vector<unsigned> ambiguous;
+	size_t recognized = 0;
+	for (unsigned i = 0; i < results.size(); i++) {
+		recognized += !results[i].trees.isZero();
+		if (results[i].trees.moreThanOne())
+			ambiguous.push_back(i);
 	}
-	return result;
+	std::stable_sort(ambiguous.begin(), ambiguous.end(), [&](unsigned a, unsigned b) { return results[b].trees < results[a].trees; });
+	cout << CYAN_TEXT << "Checked " << words.size() << " words with Grammar<" << this->id << ">: " << recognized << " recognized, " << ambiguous.size()
+		<< " of them ambiguous." << RESET_COLORING << '\n';
+	for (unsigned r = 0; r < ambiguous.size() && r < top; r++) {
+		const Result& result = results[ambiguous[r]];
+		string word(words[ambiguous[r]].data, words[ambiguous[r]].length);
+		cout << BRIGHT_YELLOW_TEXT << r + 1 << ". Line " << ambiguous[r] + 1 << " '" << word << "' - " << result.trees.toString() << " parse trees" << RESET_COLORING;
+		if (result.nt != NO_SYMBOL) {
+			cout << BRIGHT_BLACK_TEXT << ", smallest ambiguous span [" << result.start << ',' << result.start + result.len << ") '" << word.substr(result.start, result.len)
+				<< "' from " << symbolName(result.nt) << RESET_COLORING;
+		}
+		cout << '\n';
+	}
+	return true;
 }
 
-bool Grammar::CYK(string word) const {
-	if (!Chomsky()) {
-		cerr << RED_TEXT << "Grammar is not in Chomsky Normal Form. Algorithm CYK cannot be executed.\n" <<
-									"You can use 'chomskify' command to make grammar in Chomsky Normal Form." << RESET_COLORING << endl;
+//Prints the parse tree of word with the biggest weight. beam > 0 keeps only the 'beam' best non-terminals of every span - check ViterbiParser
+bool Grammar::Viterbi(const string& word, unsigned beam) const {
+	if (!cykRecognizer())
 		return false;
+	ViterbiParser parser(rules, compile(), word, beam);
+	if (!parser.recognized()) {
+		if (beam == 0)
+			cout << BRIGHT_RED_TEXT << "Word '" << word << "' is NOT recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+		else
+			cout << BRIGHT_RED_TEXT << "Word '" << word << "' has no parse tree in Grammar<" << this->id << "> within beam of " << beam << "!" << RESET_COLORING << '\n';
+		return true;
 	}
-	//Algorithm at page 33 at : https://learn.fmi.uni-sofia.bg/pluginfile.php/193362/mod_resource/content/1/3contextfreegram.pdf
+	cout << BRIGHT_GREEN_TEXT << "Most probable parse tree of '" << word << "' in Grammar<" << this->id << "> has log-probability " << parser.logWeight()
+		<< " (probability " << std::exp(parser.logWeight()) << "):" << RESET_COLORING << '\n';
+	parser.writeTree(cout, rules, [this](symbol s) { return symbolName(s); });
+	cout << '\n';
+	return true;
+}
 
-	unsigned wordLength = word.length();
-	
-	map <pair<int, int>, vector<string> > table;	//key: (i,j), value {set of NTs} -- represents table from algorithm
-													//Empty cells simply won't exist in map.
-	for (unsigned i = 0; i < wordLength; i++) { //Fill first row of table
-		for (const auto& rule : rules) {
-			if (rule.product.size() == 1 && (rule.product[0][0] == word[i])) { //no need to check if product is terminal since CNF
-				auto tit = table.find({ i, 0} ); //if key is found in map add NT to its value IF NOT ALREADY EXISTING
-				if (tit != table.end()) {
-					bool already_exists = false;;
-					for (auto rpit = (*tit).second.cbegin(); !already_exists && rpit != (*tit).second.cend(); ++rpit) {
-						already_exists = (*rpit) == rule.nonTerminal;
-					}
-					if(!already_exists)
-						(*tit).second.push_back(rule.nonTerminal);
-				}
-				else {	//if key is not found in map add new elepemt to map with given key and value vector with only one string - NT of rule
-					vector<string> tempVS;
-					tempVS.push_back(rule.nonTerminal);
-					pair<int, int> tempPair = { i, 0 };
-					table.emplace(tempPair, tempVS );
+//Rules which no tree of the corpus uses get this weight instead of 0, so they stay valid rules which can be saved and loaded
+const double MIN_TRAINED_WEIGHT = 1e-30;
+//Words are split into this many blocks, each with its own counts, no matter how many threads there are. Counts are added up
+//in the same order every time, so trained weights do not depend on the number of threads.
+const size_t TRAINING_BLOCKS = 64;
+
+//Inside-outside EM over words: every iteration adds up expected uses of rules in trees of every word (E step) and sets weight of
+//every rule to its share of expected uses of rules of its non-terminal (M step). Words are split in blocks which threads take
+//one by one, and every block adds up its own counts, so threads share nothing until the counts are merged at the end of the iteration.
+bool Grammar::Train(const vector<TextLine>& words, unsigned iterations, unsigned threads) {
+	if (!cykRecognizer())
+		return false;
+	ThreadPool pool(threads);
+	const size_t blocks = std::max<size_t>(1, std::min<size_t>(words.size(), TRAINING_BLOCKS));
+	const size_t grain = (words.size() + blocks - 1) / blocks;
+	//Weights of every non-terminal are scaled to sum to 1 first - text grammars start with all weights 1, and the first
+	//E step would otherwise report a sum of tree weights instead of a log-likelihood
+	{
+		const CompiledGrammar& index = compile();
+		bool scaled = false;
+		for (symbol nt = 0; nt < nonTerminals.size(); nt++) {
+			double total = 0.0;
+			for (const unsigned* r = index.rulesOfBegin(nt); r != index.rulesOfEnd(nt); r++)
+				total += rules[*r].weight;
+			for (const unsigned* r = index.rulesOfBegin(nt); r != index.rulesOfEnd(nt); r++) {
+				double weight = rules[*r].weight / total;
+				if (rules[*r].weight != weight) {
+					rules.modify(*r).weight = weight;
+					scaled = true;
 				}
 			}
 		}
+		if (scaled)
+			invalidate();
 	}
-
-	for (unsigned j = 1; j < wordLength; j++) { //Fill rows 2+ of table
-		for (unsigned i = 0; i < wordLength - j; i++) {
-			for (unsigned k = 0; k < j ; k++) {
-				auto tit1 = table.find({ i, k });
-				auto tit2 = table.find({ i + k + 1, j - k - 1});
-				if (tit1 != table.end() && tit2 != table.end() ) { // Both cells are not empty
-					vector<pair<string, string> > temp = crossJoin((*tit1).second, (*tit2).second);
-					for (auto vectorElement : temp) { //iterate over rules and try to find Nt that can be replaced with any of elements in crossJoined vector - check algorithm
-						for (const auto rule : rules) {
-							//Elements in cross joined vector consist of 2 NTs so searching for rules with products of size 2
-							if (rule.product.size() == 2 && rule.product[0] == vectorElement.first && rule.product[1] == vectorElement.second) {
-								auto tit = table.find({ i, j }); //if key is found in map add NT to its value IF NOT ALREADY EXISTING -- key = cell
-								if (tit != table.end()) {
-									bool already_exists = stringOccursInVector((*tit).second, rule.nonTerminal);
-									if (!already_exists)
-										(*tit).second.push_back(rule.nonTerminal);
-								}
-								else {	//if key is not found in map add new elepemt to map with given key and value vector with only one string - NT of rule
-									vector<string> tempVS;
-									tempVS.push_back(rule.nonTerminal);
-									pair<int, int> tempPair = { i, j };
-									table.emplace(tempPair, tempVS);
-								}
-							}
-						}
+	for (unsigned iteration = 1; iteration <= iterations; iteration++) {
+		auto started = std::chrono::steady_clock::now();
+		const CompiledGrammar& index = compile();
+		vector<vector<double> > blockCounts(blocks);
+		vector<double> blockLikelihood(blocks, 0.0);
+		vector<size_t> blockParsed(blocks, 0);
+		pool.parallelFor(0, blocks, 1, [&](size_t begin, size_t end) {
+			InsideOutside chart(rules, index);
+			for (size_t block = begin; block < end; block++) {
+				blockCounts[block].assign(rules.size(), 0.0);
+				for (size_t i = block * grain; i < std::min(words.size(), (block + 1) * grain); i++) {
+					double logProbability = chart.addCounts(words[i].data, words[i].length, blockCounts[block]);
+					if (logProbability != -std::numeric_limits<double>::infinity()) {
+						blockLikelihood[block] += logProbability;
+						blockParsed[block]++;
 					}
 				}
 			}
+		});
+
+		vector<double> counts(rules.size(), 0.0);
+		double likelihood = 0.0;
+		size_t parsed = 0;
+		for (size_t b = 0; b < blocks; b++) {
+			for (size_t r = 0; r < blockCounts[b].size(); r++)
+				counts[r] += blockCounts[b][r];
+			likelihood += blockLikelihood[b];
+			parsed += blockParsed[b];
+		}
+		for (symbol nt = 0; nt < nonTerminals.size(); nt++) {
+			double total = 0.0;
+			for (const unsigned* r = index.rulesOfBegin(nt); r != index.rulesOfEnd(nt); r++)
+				total += counts[*r];
+			if (total == 0.0) //no tree uses nt, so its weights stay
+				continue;
+			for (const unsigned* r = index.rulesOfBegin(nt); r != index.rulesOfEnd(nt); r++) {
+				double weight = std::max(counts[*r] / total, MIN_TRAINED_WEIGHT);
+				if (rules[*r].weight != weight)
+					rules.modify(*r).weight = weight;
+			}
 		}
+		invalidate(); //index is not used after this
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		cout << CYAN_TEXT << "Iteration " << iteration << ": log-likelihood " << likelihood << " of " << parsed << " of " << words.size()
+			<< " words, " << (seconds > 0 ? words.size() / seconds : 0.0) << " words/s" << RESET_COLORING << '\n';
+		if (parsed == 0)
+			break;
+	}
+	cout << BRIGHT_GREEN_TEXT << "Weights of rules of Grammar<" << this->id << "> were trained on " << words.size() << " words!" << RESET_COLORING << '\n';
+	return true;
+}
+
+//Words drawn by one random engine. Engines of blocks are seeded by (seed, block), so output only depends on seed and not on
+//the number of threads.
+const size_t GENERATION_BLOCK_WORDS = 1024;
+//Blocks or prefixes handed to every thread before their output is written, which bounds the memory output takes
+const size_t OUTPUT_ROUND_PER_THREAD = 4;
+
+//Output file is only opened, and so emptied, once grammar is known to have words to write
+static bool openOutput(std::ofstream& out, const string& outputFile) {
+	out.open(outputFile, std::ios::binary);
+	if (!out.good()) {
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
+		return false;
 	}
+	return true;
+}
 
-	auto tit = table.find({ 0, wordLength - 1});
-	if (tit != table.end()) {
-		for (auto i : (*tit).second) { //search for S -- check algorithm
-			if (i == startSymbol) {
-				cout << BRIGHT_GREEN_TEXT << "Word '" << word << "' is recognized by Grammar<"<< this->id << ">!" << RESET_COLORING << endl;
-				return true;
+//Writes count random words of exactly length letters to outputFile, one per line. Blocks of words are drawn in parallel and
+//written in order of blocks, a round at a time - check WordSampler. seed 0 draws a seed, which is printed so the words can be drawn again.
+bool Grammar::Generate(unsigned length, unsigned count, unsigned seed, const string& outputFile, unsigned threads) const {
+	if (!cykRecognizer())
+		return false;
+	ThreadPool pool(threads);
+	WordSampler sampler(rules, compile(), length, pool);
+	if (sampler.treeCount().isZero()) {
+		cout << BRIGHT_RED_TEXT << "Grammar<" << this->id << "> has no word of length " << length << "!" << RESET_COLORING << '\n';
+		return false;
+	}
+	std::ofstream out;
+	if (!openOutput(out, outputFile))
+		return false;
+	while (seed == 0)
+		seed = std::random_device()();
+	const size_t blocks = (count + GENERATION_BLOCK_WORDS - 1) / GENERATION_BLOCK_WORDS;
+	const size_t round = pool.size() * OUTPUT_ROUND_PER_THREAD;
+	vector<string> output(std::min(blocks, round));
+	for (size_t first = 0; first < blocks; first += round) {
+		const size_t last = std::min(blocks, first + round);
+		pool.parallelFor(first, last, 1, [&](size_t begin, size_t end) {
+			WordSampler::Stack stack;
+			for (size_t block = begin; block < end; block++) {
+				std::seed_seq sequence{ static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(block), static_cast<std::uint32_t>(block >> 32) };
+				WordSampler::Engine engine(sequence);
+				string& text = output[block - first];
+				text.clear();
+				for (size_t i = block * GENERATION_BLOCK_WORDS; i < std::min<size_t>(count, (block + 1) * GENERATION_BLOCK_WORDS); i++)
+					sampler.sample(engine, text, stack);
+			}
+		});
+		for (size_t block = first; block < last; block++)
+			out.write(output[block - first].data(), output[block - first].size());
+	}
+	cout << BRIGHT_GREEN_TEXT << count << " random words of length " << length << " were generated from Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+	cout << CYAN_TEXT << "Words were drawn from " << sampler.treeCount().toString() << " parse trees, each equally likely. Words are equally likely"
+		<< " if the grammar is unambiguous." << RESET_COLORING << '\n';
+	cout << CYAN_TEXT << "Seed: " << seed << " - pass seed=" << seed << " to draw the same words again." << RESET_COLORING << '\n';
+	return true;
+}
+
+//Writes every word of length up to maxLength to outputFile in lexicographic order, one per line. The search is split at the first
+//depth with enough prefixes to keep every thread busy; words of the prefixes are listed in parallel and written in order.
+bool Grammar::Enumerate(unsigned maxLength, const string& outputFile, unsigned threads) const {
+	std::shared_ptr<const CYKRecognizer> recognizer = cykRecognizer();
+	if (!recognizer)
+		return false;
+	std::ofstream out;
+	if (!openOutput(out, outputFile))
+		return false;
+	ThreadPool pool(threads);
+	WordEnumerator enumerator(*recognizer, compile(), maxLength);
+	const size_t round = pool.size() * OUTPUT_ROUND_PER_THREAD;
+	vector<WordEnumerator::Item> items;
+	for (unsigned depth = 1; ; depth++) {
+		items = enumerator.split(depth);
+		size_t prefixes = std::count_if(items.begin(), items.end(), [](const WordEnumerator::Item& item) { return item.prefix; });
+		if (depth >= maxLength || prefixes >= round * 4 || prefixes == 0)
+			break;
+	}
+
+	size_t listed = 0;
+	vector<size_t> tasks;
+	vector<string> output;
+	vector<size_t> counts;
+	for (size_t first = 0; first < items.size();) {
+		size_t last = first;
+		tasks.clear();
+		while (last < items.size() && tasks.size() < round) {
+			if (items[last].prefix)
+				tasks.push_back(last);
+			last++;
+		}
+		output.assign(tasks.size(), string());
+		counts.assign(tasks.size(), 0);
+		pool.parallelFor(0, tasks.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++)
+				counts[t] = enumerator.listWords(items[tasks[t]].text, output[t]);
+		});
+		for (size_t i = first, t = 0; i < last; i++) {
+			if (items[i].prefix) {
+				out.write(output[t].data(), output[t].size());
+				listed += counts[t++];
+			}
+			else {
+				out << items[i].text << '\n';
+				listed++;
 			}
 		}
+		first = last;
 	}
-	cout << BRIGHT_RED_TEXT << "Word '" << word << "' is NOT recognized by Grammar<" << this->id << ">!" << RESET_COLORING << endl;
-	return false;
+	cout << BRIGHT_GREEN_TEXT << listed << " words of length up to " << maxLength << " of Grammar<" << this->id << "> were listed in lexicographic order!"
+		<< RESET_COLORING << '\n';
+	return true;
+}
+
+//Checks every word with one recognizer. accepted[i] becomes 1 if words[i] is recognized and 0 otherwise.
+//Words are spread in chunks over threads; every chunk reuses one chart buffer.
+bool Grammar::CYKBatch(const vector<TextLine>& words, vector<char>& accepted, unsigned threads) const {
+	std::shared_ptr<const CYKRecognizer> recognizer = cykRecognizer();
+	if (!recognizer)
+		return false;
+	accepted.assign(words.size(), 0);
+	ThreadPool pool(threads);
+	pool.parallelFor(0, words.size(), 256, [&](size_t begin, size_t end) {
+		vector<bitWord> chart;
+		for (size_t i = begin; i < end; i++) {
+			accepted[i] = recognizer->recognize(words[i].data, words[i].length, chart) ? 1 : 0;
+		}
+	});
+	return true;
+}
+
+//Prints result for every word. Words sharing a prefix reuse its part of the chart - check CYKSession
+bool Grammar::CYKWords(const vector<string>& words) const {
+	std::shared_ptr<const CYKRecognizer> recognizer = cykRecognizer();
+	if (!recognizer)
+		return false;
+	CYKSession session(recognizer);
+	vector<bool> recognized = session.recognizeAll(words);
+	for (unsigned i = 0; i < words.size(); i++) {
+		if (recognized[i])
+			cout << BRIGHT_GREEN_TEXT << "Word '" << words[i] << "' is recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+		else
+			cout << BRIGHT_RED_TEXT << "Word '" << words[i] << "' is NOT recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+	}
+	return true;
+}
+
+//Appends letters of word one by one as an editor would and prints result after every letter
+bool Grammar::CYKPrefixes(const string& word) const {
+	std::shared_ptr<const CYKRecognizer> recognizer = cykRecognizer();
+	if (!recognizer)
+		return false;
+	CYKSession session(recognizer);
+	for (char letter : word) {
+		session.append(letter);
+		if (session.accepted())
+			cout << BRIGHT_GREEN_TEXT << "Prefix '" << session.word() << "' is recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+		else
+			cout << BRIGHT_RED_TEXT << "Prefix '" << session.word() << "' is NOT recognized by Grammar<" << this->id << ">!" << RESET_COLORING << '\n';
+	}
+	return true;
 }
 
 bool Grammar::Empty() const {
 	//Algorithm at page 55 at : https://learn.fmi.uni-sofia.bg/pluginfile.php/193362/mod_resource/content/1/3contextfreegram.pdf
-	vector<string> marked;
-	for (const char terminal : terminals) { //Add all terminals to vector representing 'marked' T/NTs
-		string temp;
-		temp = terminal;
-		marked.push_back(temp);
-		marked.push_back("@");
-	}
-	bool added = false;
-	do {
-		added = false;
-		for (auto& rule : rules) {
-			bool addToMarked = true;
-			auto rpit = rule.product.cbegin();
-			while (addToMarked && rpit != rule.product.cend()) { //if whole product is made up from elements of marked -> add NT
-				addToMarked = stringOccursInVector(marked, (*rpit));
-				rpit++;
-			}
-			if (addToMarked && !stringOccursInVector(marked, rule.nonTerminal)) {
-				marked.push_back(rule.nonTerminal);
-				added = true;
-			}
+	//Marked (productive) non-terminals are found by a linear worklist when the snapshot is built - check CompiledGrammar
+	if (startSymbol == NO_SYMBOL)
+		return true;
+	return !compile().productive(startSymbol);
+}
+
+//Removes non-productive non-terminals (which derive no word), then non-terminals unreachable from the starting symbol,
+//together with every rule that uses them. Starting symbol is always kept. Remaining non-terminals keep their order.
+void Grammar::Reduce() {
+	if (startSymbol == NO_SYMBOL)
+		return;
+	vector<bool> useful = productiveNonTerminals(rules, nonTerminals.size());
+	auto onlyProductive = [&](const ProductionRule& rule) {
+		if (!useful[rule.nonTerminal])
+			return false;
+		for (symbol p : rule.product) {
+			if (!isTerminalSymbol(p) && !useful[p])
+				return false;
 		}
-	} while (added); //repeat untill there are NTs to add to marked
-	return !stringOccursInVector(marked, startSymbol);
+		return true;
+	};
+	vector<bool> reachable = reachableNonTerminals(rules, nonTerminals.size(), startSymbol, onlyProductive);
+	for (symbol nt = 0; nt < nonTerminals.size(); nt++)
+		useful[nt] = useful[nt] && reachable[nt];
+	useful[startSymbol] = true;
+
+	vector<symbol> renamed(nonTerminals.size(), NO_SYMBOL); //index: old id, value: new id
+	SymbolTable reducedNonTerminals;
+	for (symbol nt = 0; nt < nonTerminals.size(); nt++) {
+		if (useful[nt])
+			renamed[nt] = reducedNonTerminals.intern(nonTerminals[nt]);
+	}
+	productions reducedRules;
+	for (const auto& rule : rules) {
+		if (onlyProductive(rule) && useful[rule.nonTerminal])
+			reducedRules.push_back(renamedRule(rule, renamed));
+	}
+	nonTerminals = reducedNonTerminals;
+	rules.assign(std::move(reducedRules));
+	startSymbol = renamed[startSymbol];
+	resetRuleSet();
+	invalidate();
 }
 
 void Grammar::print(std::ostream& os) {
@@ -746,11 +1304,10 @@ void Grammar::print(std::ostream& os) {
 
 	const string indent = "   ";
 	const string indentProductions = "                     ";
-	os << YELLOW_TEXT << "Grammar<" << id << '>'<< RESET_COLORING << endl;
+	os << YELLOW_TEXT << "Grammar<" << id << '>'<< RESET_COLORING << '\n';
 	os << indent << "Non-terminals: ";
 	unsigned nonTerminalsCount = nonTerminals.size();
 	unsigned terminalsCount = terminals.size();
-	unsigned rulesCount = rules.size();
 	for (unsigned i = 0; i < nonTerminalsCount; i++) {
 		os << nonTerminals[i] ;
 		if (i < nonTerminalsCount - 1)
@@ -765,15 +1322,13 @@ void Grammar::print(std::ostream& os) {
 		
 	}
 	os << '\n';
-	os << indent << "Starting Symbol: " << startSymbol << '\n';
+	os << indent << "Starting Symbol: " << nonTerminals[startSymbol] << '\n';
 	os << indent << "Produciton Rules: ";
 	for (int i = 0; i < rules.size(); i++) {
 		if(i > 0)
 			os << indentProductions;
-		os << i << ". "<<  rules[i].nonTerminal << "->";
-		for (auto p : rules[i].product) {
-			os << p;
-		}
+		os << i << ". ";
+		printRule(os, rules[i]);
 		os << '\n';
 	}
 	if (rules.empty())
@@ -781,37 +1336,43 @@ void Grammar::print(std::ostream& os) {
 }
 
 //Removes unnecessary @ in products 
-bool Grammar::addRule(const std::string& rule, bool printInfo) { //printInfo = false - function will show nothing on console no matter what has it done
+//Parses rule against symbols of grammar without changing it, so it can be called from many threads at once.
+//If rule is invalid returns false and error explains why.
+bool Grammar::parseRule(const std::string& line, ProductionRule& parsed, string& error) const {
+	//Weight is optional and follows the product after one space, i.e. "A->BC 0.25"
+	double weight = 1.0;
+	size_t space = line.find(' ');
+	if (space != string::npos && !parseWeight(line.substr(space + 1), weight)) {
+		error = string("Invalid rule entered! Weight '") + line.substr(space + 1) + "' is not a positive number!";
+		return false;
+	}
+	const string rule = line.substr(0, space);
 	//Check sttring not empty
 	if (rule.empty()) {
-		if(printInfo)
-			cerr << RED_TEXT << "Invalid rule entered!" << RESET_COLORING << endl;
+		error = "Invalid rule entered!";
 		return false;
 	}
 	//Check if inputted correctly 
 	unsigned found = rule.find("->");
 	if (found == string::npos) {
-		if(printInfo)
-			cerr << RED_TEXT << "Invalid rule entered!" << RESET_COLORING << endl;
+		error = "Invalid rule entered!";
 		return false;
 	}
 	else {
 		ProductionRule newRule;
 		string _nonTerminal;
 		_nonTerminal.assign(rule, 0, found); //Everything before -> is NT
-		if (!isExistingNonTerminal(_nonTerminal)) {
-			if(printInfo)
-				cerr << RED_TEXT << "Invalid rule entered! Non-terminal '" << _nonTerminal << "'does not exist in grammar!" << RESET_COLORING << endl;
+		newRule.nonTerminal = nonTerminalId(_nonTerminal);
+		if (newRule.nonTerminal == NO_SYMBOL) {
+			error = string("Invalid rule entered! Non-terminal '") + _nonTerminal + "'does not exist in grammar!";
 			return false;
 		}
 		else { //Starts with NT and has -> afterwards
-			newRule.nonTerminal = _nonTerminal;
 			string _product;
 			_product.assign(rule, found + 2, rule.length()); //Everything after -> is product
 			unsigned _productLength = _product.length();
 			if (_productLength == 0) {
-				if(printInfo)
-					cerr << RED_TEXT << "Invalid rule entered!" << RESET_COLORING << endl;
+				error = "Invalid rule entered!";
 				return false;
 			}
 			for (unsigned i = 0; i < _productLength; i++) {
@@ -819,28 +1380,25 @@ bool Grammar::addRule(const std::string& rule, bool printInfo) { //printInfo = f
 					continue;
 				}
 				else if (isExistingTerminal(_product[i])) { // hover isExistingTerminal -- if a terminal simply add it as a part of product
-					string productPart = "";
-					productPart.push_back(_product[i]);
-					newRule.product.push_back(productPart);
+					newRule.product.push_back(terminalSymbol(_product[i]));
 				}
 				else if (_product[i] >= 'A' && _product[i] <= 'Z') {
 					if ((i + 1 >= _productLength) || isCapitalLetter(_product[i+1]) || (isExistingTerminal(_product[i + 1]))) { //This is a 1 sized NT (capital letter) then add it
 						string productPart = "";
 						productPart.push_back(_product[i]);
-						if (isExistingNonTerminal(productPart)) {
-							newRule.product.push_back(productPart);
+						symbol part = nonTerminalId(productPart);
+						if (part != NO_SYMBOL) {
+							newRule.product.push_back(part);
 						}
 						else {
-							if(printInfo)
-								cerr << RED_TEXT << "Invalid rule entered! Non-terminal '" << productPart << "' does not exist in grammar!" << RESET_COLORING << endl;
+							error = string("Invalid rule entered! Non-terminal '") + productPart + "' does not exist in grammar!";
 							return false;
 						}
 					}
 					else if (_product[i + 1] == '_') {
 						unsigned foundUnderscope = _product.find('_', i + 2); //if there is a _ there should be second one to indicate end
 						if (foundUnderscope == string::npos) {
-							if(printInfo)
-								cerr << RED_TEXT << "Invalid rule entered! Non-terminal names with only one underscore are not allowed!" << RESET_COLORING << endl;
+							error = "Invalid rule entered! Non-terminal names with only one underscore are not allowed!";
 							return false;
 						}
 						else {
@@ -848,42 +1406,67 @@ bool Grammar::addRule(const std::string& rule, bool printInfo) { //printInfo = f
 							string::const_iterator end = _product.begin() + foundUnderscope + 1;
 							string productPart = "";
 							productPart.assign(start, end); //eveything form capital letter to second _ is a NT with an index
-							if (isExistingNonTerminal(productPart)) {
-								newRule.product.push_back(productPart);
+							symbol part = nonTerminalId(productPart);
+							if (part != NO_SYMBOL) {
+								newRule.product.push_back(part);
 								i = foundUnderscope;
 							}
 							else {
-								if(printInfo)
-									cerr << RED_TEXT << "Invalid rule entered! Non-terminal '" << productPart << "' does not exist in grammar!" << RESET_COLORING << endl;
+								error = string("Invalid rule entered! Non-terminal '") + productPart + "' does not exist in grammar!";
 								return false;
 							}
 						}
 					}
 				}
 				else {
-					if(printInfo)
-						cerr << RED_TEXT << "Invalid rule entered! Terminal '" << _product[i] << "' does not exist in grammar!" << RESET_COLORING << endl;
+					error = string("Invalid rule entered! Terminal '") + _product[i] + "' does not exist in grammar!";
 					return false;
 				}
 			}
-			rules.push_back(newRule);
-			if(printInfo)
-				cerr << GREEN_TEXT << "Rule '" << rule << "' was added to grammar with id '" << this->id<<"'" << RESET_COLORING << endl;
+			newRule.weight = weight;
+			parsed = std::move(newRule);
 			return true;
 		}
 	}
 }
 
+bool Grammar::addRule(const std::string& rule, bool printInfo) { //printInfo = false - function will show nothing on console no matter what has it done
+	ProductionRule newRule;
+	string error;
+	if (!parseRule(rule, newRule, error)) {
+		if(printInfo)
+			cerr << RED_TEXT << error << RESET_COLORING << '\n';
+		return false;
+	}
+	if (!addRule(newRule)) {
+		if(printInfo)
+			cerr << RED_TEXT << "Rule '" << rule << "' already exists in grammar with id '" << this->id << "'!" << RESET_COLORING << '\n';
+		return false;
+	}
+	if(printInfo)
+		cerr << GREEN_TEXT << "Rule '" << rule << "' was added to grammar with id '" << this->id<<"'" << RESET_COLORING << '\n';
+	return true;
+}
+
+//Adds rule made by parseRule. Returns false if grammar already has it.
+bool Grammar::addRule(const ProductionRule& rule) {
+	if (!pushRule(rule))
+		return false;
+	invalidate();
+	return true;
+}
+
 bool Grammar::removeRule(unsigned number) {
 	unsigned rulesCount = rules.size();
 	if (number < 0 || number >= rulesCount) {
-		cerr << RED_TEXT << "Attempt to delete rule at invalid index" << RESET_COLORING << endl;
+		cerr << RED_TEXT << "Attempt to delete rule at invalid index" << RESET_COLORING << '\n';
 		return false;
 	}
 	else {
-		productions::const_iterator del = rules.begin() + number;
-		rules.erase(del);
-		cerr << BRIGHT_RED_TEXT << "Rule at index '"<< number << "' in grammar with id '" << this->id << "' was deleted!" << RESET_COLORING << endl;
+		existingRules.erase(rules[number]);
+		rules.erase(number);
+		invalidate();
+		cerr << BRIGHT_RED_TEXT << "Rule at index '"<< number << "' in grammar with id '" << this->id << "' was deleted!" << RESET_COLORING << '\n';
 		return true;
 	}
 }
@@ -901,14 +1484,204 @@ void Grammar::save(std::ostream& os) {
 			os << ", ";
 	}
 	os << '\n';
-	os << this->startSymbol << '\n'; 
+	os << nonTerminals[this->startSymbol] << '\n'; 
 	for (unsigned i = 0; i < rules.size(); i++) {
-		os << rules[i].nonTerminal << "->";
-		for (auto& rp : rules[i].product) {
-			os << rp;
-		}
+		printRule(os, rules[i]);
 		if (i < rules.size() - 1) {
 			os << '\n';
 		}
 	}
 }
+
+/*
+Binary format (version 2). All numbers are 32-bit unsigned in the byte order of the machine that saved the file.
+	header:    magic "CFGB", version, NT count, T count, starting symbol, rule count, product length sum, name bytes, checksum (64-bit)
+	payload:   name offsets [NT count + 1], names [name bytes, padded to 4], terminals [T count, padded to 4],
+	           rule heads [rule count], product offsets [rule count + 1], products [product length sum], rule weights [rule count, 64-bit double]
+Products hold symbol encodings (see Symbol.h). Checksum is FNV-1a over the payload.
+Version 1 files have no rule weights and are still read - their rules get weight 1.
+*/
+const char BINARY_GRAMMAR_MAGIC[4] = { 'C', 'F', 'G', 'B' };
+const uint32_t BINARY_GRAMMAR_VERSION = 2;
+const uint32_t BINARY_GRAMMAR_UNWEIGHTED_VERSION = 1;
+
+struct BinaryGrammarHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t nonTerminalCount;
+	uint32_t terminalCount;
+	uint32_t startSymbol;
+	uint32_t ruleCount;
+	uint32_t productLength;
+	uint32_t nameBytes;
+	uint64_t checksum;
+};
+
+static uint64_t fnv1a(const char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static size_t paddedToWord(size_t bytes) {
+	return (bytes + 3) & ~static_cast<size_t>(3);
+}
+
+template <typename T>
+static void appendRaw(string& buffer, const T* data, size_t count) {
+	buffer.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+}
+
+void Grammar::saveBinary(std::ostream& os) const {
+	vector<uint32_t> nameOffsets(nonTerminals.size() + 1, 0);
+	string names;
+	for (symbol nt = 0; nt < nonTerminals.size(); nt++) {
+		names += nonTerminals[nt];
+		nameOffsets[nt + 1] = names.size();
+	}
+	size_t nameBytes = names.size();
+	names.resize(paddedToWord(nameBytes), '\0');
+
+	vector<uint32_t> heads(rules.size());
+	vector<uint32_t> productOffsets(rules.size() + 1, 0);
+	vector<uint32_t> products;
+	vector<double> weights(rules.size());
+	for (unsigned i = 0; i < rules.size(); i++) {
+		heads[i] = rules[i].nonTerminal;
+		products.insert(products.end(), rules[i].product.begin(), rules[i].product.end());
+		productOffsets[i + 1] = products.size();
+		weights[i] = rules[i].weight;
+	}
+
+	string payload;
+	appendRaw(payload, nameOffsets.data(), nameOffsets.size());
+	payload += names;
+	payload.append(terminals.begin(), terminals.end());
+	payload.resize(paddedToWord(payload.size()), '\0');
+	appendRaw(payload, heads.data(), heads.size());
+	appendRaw(payload, productOffsets.data(), productOffsets.size());
+	appendRaw(payload, products.data(), products.size());
+	appendRaw(payload, weights.data(), weights.size());
+
+	BinaryGrammarHeader header;
+	std::memcpy(header.magic, BINARY_GRAMMAR_MAGIC, sizeof(header.magic));
+	header.version = BINARY_GRAMMAR_VERSION;
+	header.nonTerminalCount = nonTerminals.size();
+	header.terminalCount = terminals.size();
+	header.startSymbol = startSymbol;
+	header.ruleCount = rules.size();
+	header.productLength = products.size();
+	header.nameBytes = nameBytes;
+	header.checksum = fnv1a(payload.data(), payload.size());
+
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	os.write(payload.data(), payload.size());
+}
+
+//Replaces contents of grammar with grammar stored in binary format. Checksum only catches accidental damage, so offsets,
+//symbols and weights are checked as well - a wrong file can neither make us read outside of it nor give rules which the
+//text format would reject. Returns false and leaves grammar unchanged if data is not a valid binary grammar.
+bool Grammar::loadBinary(const char* data, size_t size) {
+	BinaryGrammarHeader header;
+	if (size < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, BINARY_GRAMMAR_MAGIC, sizeof(header.magic)) != 0 ||
+		(header.version != BINARY_GRAMMAR_VERSION && header.version != BINARY_GRAMMAR_UNWEIGHTED_VERSION))
+		return false;
+	const bool hasWeights = header.version == BINARY_GRAMMAR_VERSION;
+
+	const size_t nameOffsetsBytes = (static_cast<size_t>(header.nonTerminalCount) + 1) * sizeof(uint32_t);
+	const size_t namesBytes = paddedToWord(header.nameBytes);
+	const size_t terminalsBytes = paddedToWord(header.terminalCount);
+	const size_t rulesBytes = (static_cast<size_t>(header.ruleCount) * 2 + 1 + header.productLength) * sizeof(uint32_t);
+	const size_t weightsBytes = hasWeights ? static_cast<size_t>(header.ruleCount) * sizeof(double) : 0;
+	const char* payload = data + sizeof(header);
+	const size_t payloadBytes = size - sizeof(header);
+	if (payloadBytes != nameOffsetsBytes + namesBytes + terminalsBytes + rulesBytes + weightsBytes || fnv1a(payload, payloadBytes) != header.checksum)
+		return false;
+	if (header.startSymbol >= header.nonTerminalCount)
+		return false;
+
+	vector<uint32_t> nameOffsets(header.nonTerminalCount + 1);
+	vector<uint32_t> heads(header.ruleCount);
+	vector<uint32_t> productOffsets(header.ruleCount + 1);
+	const char* cursor = payload;
+	std::memcpy(nameOffsets.data(), cursor, nameOffsetsBytes);
+	const char* names = cursor += nameOffsetsBytes;
+	const char* terminalChars = cursor += namesBytes;
+	cursor += terminalsBytes;
+	std::memcpy(heads.data(), cursor, heads.size() * sizeof(uint32_t));
+	cursor += heads.size() * sizeof(uint32_t);
+	std::memcpy(productOffsets.data(), cursor, productOffsets.size() * sizeof(uint32_t));
+	const char* products = cursor + productOffsets.size() * sizeof(uint32_t);
+	const char* weights = products + static_cast<size_t>(header.productLength) * sizeof(uint32_t);
+
+	if (nameOffsets[0] != 0 || nameOffsets.back() != header.nameBytes || productOffsets[0] != 0 || productOffsets.back() != header.productLength)
+		return false;
+	for (unsigned i = 0; i < header.nonTerminalCount; i++) {
+		if (nameOffsets[i] > nameOffsets[i + 1])
+			return false;
+	}
+	for (unsigned i = 0; i < header.ruleCount; i++) {
+		if (productOffsets[i] >= productOffsets[i + 1] || heads[i] >= header.nonTerminalCount)
+			return false;
+	}
+
+	Grammar grammar;
+	grammar.nonTerminals.reserve(header.nonTerminalCount);
+	for (unsigned i = 0; i < header.nonTerminalCount; i++) {
+		grammar.nonTerminals.intern(string(names + nameOffsets[i], names + nameOffsets[i + 1]));
+	}
+	if (grammar.nonTerminals.size() != header.nonTerminalCount)
+		return false;
+	for (unsigned i = 0; i < header.terminalCount; i++) {
+		grammar.addTerminal(terminalChars[i]);
+	}
+	productions loaded(header.ruleCount);
+	for (unsigned i = 0; i < header.ruleCount; i++) {
+		ProductionRule& rule = loaded[i];
+		rule.nonTerminal = heads[i];
+		rule.product.resize(productOffsets[i + 1] - productOffsets[i]);
+		std::memcpy(rule.product.data(), products + static_cast<size_t>(productOffsets[i]) * sizeof(symbol), rule.product.size() * sizeof(symbol));
+		if (hasWeights)
+			std::memcpy(&rule.weight, weights + static_cast<size_t>(i) * sizeof(double), sizeof(double));
+		if (!validWeight(rule.weight))
+			return false;
+		for (symbol p : rule.product) {
+			if (p == EPSILON_SYMBOL) { //only as the whole product, like A->@ in text
+				if (rule.product.size() != 1)
+					return false;
+			}
+			else if (isTerminalSymbol(p)) {
+				if (p != terminalSymbol(terminalOf(p)) || !grammar.isExistingTerminal(terminalOf(p)))
+					return false;
+			}
+			else if (p >= header.nonTerminalCount) {
+				return false;
+			}
+		}
+	}
+	grammar.rules.assign(std::move(loaded));
+	grammar.resetRuleSet();
+	grammar.startSymbol = header.startSymbol;
+	*this = std::move(grammar);
+	return true;
+}
+
+//Memory held by grammar. Names and chunks of rules which other grammars share (see ChunkedVector) are counted as shared.
+MemoryUsage Grammar::memoryUsage() const {
+	MemoryUsage usage;
+	usage.add(sizeof(*this) + terminals.capacity(), false);
+	usage.add(nonTerminals.memoryUsage());
+	usage.add(rules.memoryUsage([](const ProductionRule& rule) { return heapBytes(rule); }));
+	size_t ruleSetBytes = existingRules.bucket_count() * sizeof(void*);
+	for (const auto& rule : existingRules)
+		ruleSetBytes += sizeof(ProductionRule) + 2 * sizeof(void*) + heapBytes(rule);
+	usage.add(ruleSetBytes, false);
+	if (compiled) //copies made before the last change share the snapshot
+		usage.add(compiled->memoryBytes(), compiled.use_count() > 1);
+	return usage;
+}
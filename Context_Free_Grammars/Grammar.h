@@ -1,14 +1,33 @@
 #pragma once
 
 #include "Identified.h"
+#include "Console.h"
 #include "ProducitonRule.h"
+#include "SymbolTable.h"
+#include "CYKRecognizer.h"
+#include "CYKSession.h"
+#include "MappedFile.h"
+#include "EarleyRecognizer.h"
+#include "CompiledGrammar.h"
+#include "Composition.h"
+#include "ParseForest.h"
+#include "DerivationCounts.h"
+#include "ViterbiParser.h"
+#include "InsideOutside.h"
+#include "WordSampler.h"
+#include "WordEnumerator.h"
 #include <vector>
+#include <bitset>
+#include <array>
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <utility>
 #include <windows.h>
 #include <map>
 #include <tuple>
+#include <memory>
+#include <unordered_set>
 
 
 using std::string;
@@ -23,13 +42,29 @@ using std::cerr;
 using terminalSet = std::vector<char>;
 using nonTerminalSet = std::vector<string>;
 using productions = std::vector<ProductionRule>;
+using ruleSet = std::unordered_set<ProductionRule, ProductionRuleHash>;
+
+const unsigned ENGLISH_ALPHABET_COUNT = 26;
 
 class Grammar : public Identidied {
 private:
-	nonTerminalSet nonTerminals;
+	SymbolTable nonTerminals;
 	terminalSet terminals;
-	productions rules;
-	string startSymbol;
+	std::bitset<256> terminalLookup; //terminalLookup[c] is set iff c is in terminals
+	RuleStore rules;
+	mutable ruleSet existingRules; //same rules as in 'rules', for O(1) duplicate checks. Built on first check, copies do not get it.
+	mutable bool ruleSetValid;
+	symbol startSymbol;
+	mutable std::shared_ptr<const CompiledGrammar> compiled; //built on first query, reset whenever rules or symbols change
+	mutable std::shared_ptr<const ParseForest> lastForest; //forest of last parsed word, reset together with compiled
+
+	//Fresh name allocator state: first index of every letter and of letterless names which may still be free
+	mutable std::array<unsigned, ENGLISH_ALPHABET_COUNT> nextIndexOfLetter;
+	mutable unsigned nextSingleLetter;
+	mutable unsigned nextIndexedName;
+
+	const CompiledGrammar& compile() const;
+	void invalidate() { compiled.reset(); lastForest.reset(); }
 
 	bool isTerminal(const char c) const;
 	bool isNonTerminal(const string& s) const;
@@ -39,35 +74,75 @@ private:
 
 	bool isExistingTerminal(const char& t) const;
 	bool isExistingNonTerminal(const string& nt) const;
+	bool isExistingNonTerminal(symbol nt) const;
+	bool isExistingSymbol(symbol s) const;
 
 	bool isValidProductionRule(const ProductionRule& rule) const;
-	unsigned rulesOfNonTerminalCount(const string& s) const;
+	unsigned rulesOfNonTerminalCount(symbol nt) const;
+	
+	string symbolName(symbol s) const;
+	void printRule(std::ostream& os, const ProductionRule& rule) const;
+	void addTerminal(char t);
 	
 	string createIndexedNonTerminal(char letter, unsigned index) const;
 	string generateNonTerminalName(char prefLetter = '\0') const;
 
 	bool addNonTerminal(string nt);
+	symbol nonTerminalId(const string& nt) const;
 	bool RuleAlreadyExists(const ProductionRule& pr) const;
+	void ensureRuleSet() const;
+	bool pushRule(const ProductionRule& pr);
+	void appendNewRule(const ProductionRule& pr);
+	void resetRuleSet();
+	ProductionRule renamedRule(const ProductionRule& rule, const vector<symbol>& renamed) const;
+	symbol appendComposition(const Composition& node);
 	
 	void sortRules();
 public:
 	Grammar();
 	Grammar(nonTerminalSet nonTerminals, terminalSet Terminals, productions rules, string startSymbol, unsigned id);
+	explicit Grammar(const Composition& composition);
 	Grammar(const Grammar& other);
+	Grammar(Grammar&& other) noexcept;
 	Grammar& operator = (const Grammar& other);
+	Grammar& operator = (Grammar&& other) noexcept;
 
-	Grammar& Union(const Grammar& other) const;
-	Grammar& Concat(const Grammar& other) const;
-	Grammar& Iter() const;
 	bool Chomsky() const;
 	void Chomskify();
-	bool CYK(string word) const;
+	std::shared_ptr<const CYKRecognizer> cykRecognizer() const;
+	const EarleyRecognizer& earleyRecognizer() const { return compile().earleyRecognizer(rules); }
+	bool CYK(string word, unsigned threads = 1) const;
+	bool CYKWords(const vector<string>& words) const;
+	bool CYKPrefixes(const string& word) const;
+	bool Earley(string word) const;
+	std::shared_ptr<const ParseForest> parseForest(const string& word) const;
+	bool Parse(const string& word, unsigned long long trees) const;
+	bool PrintForest(const string& word) const;
+	bool Ambiguity(const string& word, bool exact) const;
+	bool AmbiguityBatch(const vector<TextLine>& words, unsigned top, unsigned threads) const;
+	bool Viterbi(const string& word, unsigned beam) const;
+	bool Train(const vector<TextLine>& words, unsigned iterations, unsigned threads);
+	bool Generate(unsigned length, unsigned count, unsigned seed, const string& outputFile, unsigned threads) const;
+	bool Enumerate(unsigned maxLength, const string& outputFile, unsigned threads) const;
+	bool CYKBatch(const vector<TextLine>& words, vector<char>& accepted, unsigned threads) const;
 	bool Empty() const;
+	void Reduce();
+
+	const RuleStore& getRules() const { return rules; }
+	unsigned nonTerminalCount() const { return nonTerminals.size(); }
+	symbol getStartSymbol() const { return startSymbol; }
+	bool sameTerminals(const Grammar& other) const { return terminalLookup == other.terminalLookup; }
+	bool isWeighted() const;
+	MemoryUsage memoryUsage() const;
 
 	void print(std::ostream& os = cout);
+	bool parseRule(const std::string& rule, ProductionRule& parsed, string& error) const;
 	bool addRule(const std::string& rule, bool printInfo = true);
+	bool addRule(const ProductionRule& rule);
 	bool removeRule(unsigned number);
 	void save(std::ostream& os);
+	void saveBinary(std::ostream& os) const;
+	bool loadBinary(const char* data, size_t size);
 };
 
 inline bool isSmallLetter(char c) {
@@ -0,0 +1,206 @@
+#include "InsideOutside.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+const int InsideOutside::EMPTY_CELL = INT_MIN / 4; //sums of three of them still fit in int
+
+InsideOutside::InsideOutside(const RuleStore& rules, const CompiledGrammar& index)
+	: index(index), weights(rules.size()), emptyRule(NO_RULE), n(0), ntCount(index.nonTerminalCount()),
+	inside(), outside(), insideExponent(), outsideExponent(), present() {
+	for (unsigned r = 0; r < rules.size(); r++)
+		weights[r] = rules[r].weight;
+	const symbol start = index.startingSymbol();
+	if (start < ntCount) {
+		for (const unsigned* r = index.rulesOfBegin(start); r != index.rulesOfEnd(start); r++) {
+			if (rules[*r].product.size() == 1 && rules[*r].product[0] == EPSILON_SYMBOL)
+				emptyRule = *r;
+		}
+	}
+}
+
+//Scales values of a cell so that the biggest one is in [0.5, 1) and moves the scale into exponent
+void InsideOutside::normalize(double* values, const std::vector<symbol>& nonZero, int& exponent) const {
+	double biggest = 0.0;
+	for (symbol nt : nonZero)
+		biggest = std::max(biggest, values[nt]);
+	if (biggest == 0.0) {
+		exponent = EMPTY_CELL;
+		return;
+	}
+	int shift;
+	std::frexp(biggest, &shift);
+	const double scale = std::ldexp(1.0, -shift);
+	for (symbol nt : nonZero)
+		values[nt] *= scale;
+	exponent += shift;
+}
+
+//Same loop as DerivationCounts. Splits are added relative to the biggest exponent of the cell, so small ones may underflow
+//to 0 - they are too small to change the sum anyway.
+void InsideOutside::fillInside(const char* word) {
+	inside.assign(cellCount() * ntCount, 0.0);
+	insideExponent.assign(cellCount(), EMPTY_CELL);
+	present.resize(std::max<size_t>(present.size(), cellCount()));
+	for (size_t cell = 0; cell < cellCount(); cell++)
+		present[cell].clear();
+
+	for (unsigned i = 0; i < n; i++) {
+		const size_t cell = cellIndex(i, 1);
+		double* values = &inside[cell * ntCount];
+		const symbol* head = index.terminalHeadsBegin(word[i]);
+		for (const unsigned* r = index.terminalRulesBegin(word[i]); r != index.terminalRulesEnd(word[i]); r++, head++) {
+			values[*head] = weights[*r]; //rules are unique, so A->c is the only way
+			present[cell].push_back(*head);
+		}
+		insideExponent[cell] = 0;
+		normalize(values, present[cell], insideExponent[cell]);
+	}
+	for (unsigned len = 2; len <= n; len++) {
+		for (unsigned i = 0; i + len <= n; i++) {
+			const size_t cell = cellIndex(i, len);
+			int top = EMPTY_CELL;
+			for (unsigned k = 1; k < len; k++) {
+				const int left = insideExponent[cellIndex(i, k)], right = insideExponent[cellIndex(i + k, len - k)];
+				if (left != EMPTY_CELL && right != EMPTY_CELL)
+					top = std::max(top, left + right);
+			}
+			if (top == EMPTY_CELL)
+				continue;
+			double* values = &inside[cell * ntCount];
+			for (unsigned k = 1; k < len; k++) {
+				const size_t left = cellIndex(i, k), right = cellIndex(i + k, len - k);
+				if (insideExponent[left] == EMPTY_CELL || insideExponent[right] == EMPTY_CELL)
+					continue;
+				const double scale = std::ldexp(1.0, insideExponent[left] + insideExponent[right] - top);
+				const double* rightValues = &inside[right * ntCount];
+				for (symbol first : present[left]) {
+					const double leftValue = inside[left * ntCount + first] * scale;
+					for (const CompiledGrammar::BinaryRule* rule = index.pairsOfBegin(first); rule != index.pairsOfEnd(first); rule++)
+						values[rule->head] += leftValue * rightValues[rule->second] * weights[rule->rule];
+				}
+			}
+			for (symbol nt = 0; nt < ntCount; nt++) {
+				if (values[nt] != 0.0)
+					present[cell].push_back(nt);
+			}
+			insideExponent[cell] = top;
+			normalize(values, present[cell], insideExponent[cell]);
+		}
+	}
+}
+
+//Outside of (B, span) sums over the parents of the span: B as first child of A->BC with C right of the span, and B as
+//second child of A->CB with C left of it. Parents are longer, so going from long spans to short ones pulls finished values.
+void InsideOutside::fillOutside() {
+	outside.assign(cellCount() * ntCount, 0.0);
+	outsideExponent.assign(cellCount(), EMPTY_CELL);
+	outside[cellIndex(0, n) * ntCount + index.startingSymbol()] = 1.0;
+	outsideExponent[cellIndex(0, n)] = 0;
+	for (unsigned len = n - 1; len >= 1; len--) {
+		for (unsigned i = 0; i + len <= n; i++) {
+			const size_t cell = cellIndex(i, len);
+			if (insideExponent[cell] == EMPTY_CELL)
+				continue;
+			int top = EMPTY_CELL;
+			for (unsigned m = 1; i + len + m <= n; m++) {
+				const int parent = outsideExponent[cellIndex(i, len + m)], sibling = insideExponent[cellIndex(i + len, m)];
+				if (parent != EMPTY_CELL && sibling != EMPTY_CELL)
+					top = std::max(top, parent + sibling);
+			}
+			for (unsigned m = 1; m <= i; m++) {
+				const int parent = outsideExponent[cellIndex(i - m, len + m)], sibling = insideExponent[cellIndex(i - m, m)];
+				if (parent != EMPTY_CELL && sibling != EMPTY_CELL)
+					top = std::max(top, parent + sibling);
+			}
+			if (top == EMPTY_CELL)
+				continue;
+			double* values = &outside[cell * ntCount];
+			const double* insideValues = &inside[cell * ntCount];
+			for (unsigned m = 1; i + len + m <= n; m++) {
+				const size_t parent = cellIndex(i, len + m), sibling = cellIndex(i + len, m);
+				if (outsideExponent[parent] == EMPTY_CELL || insideExponent[sibling] == EMPTY_CELL)
+					continue;
+				const double scale = std::ldexp(1.0, outsideExponent[parent] + insideExponent[sibling] - top);
+				const double* parentValues = &outside[parent * ntCount];
+				const double* siblingValues = &inside[sibling * ntCount];
+				for (symbol first : present[cell]) {
+					double sum = 0.0;
+					for (const CompiledGrammar::BinaryRule* rule = index.pairsOfBegin(first); rule != index.pairsOfEnd(first); rule++)
+						sum += parentValues[rule->head] * siblingValues[rule->second] * weights[rule->rule];
+					values[first] += sum * scale;
+				}
+			}
+			for (unsigned m = 1; m <= i; m++) {
+				const size_t parent = cellIndex(i - m, len + m), sibling = cellIndex(i - m, m);
+				if (outsideExponent[parent] == EMPTY_CELL || insideExponent[sibling] == EMPTY_CELL)
+					continue;
+				const double scale = std::ldexp(1.0, outsideExponent[parent] + insideExponent[sibling] - top);
+				const double* parentValues = &outside[parent * ntCount];
+				for (symbol first : present[sibling]) {
+					const double siblingValue = inside[sibling * ntCount + first] * scale;
+					for (const CompiledGrammar::BinaryRule* rule = index.pairsOfBegin(first); rule != index.pairsOfEnd(first); rule++) {
+						if (insideValues[rule->second] != 0.0) //others take part in no tree
+							values[rule->second] += parentValues[rule->head] * siblingValue * weights[rule->rule];
+					}
+				}
+			}
+			outsideExponent[cell] = top;
+			normalize(values, present[cell], outsideExponent[cell]);
+		}
+	}
+}
+
+//Expected uses of A->BC over span (i, len) split after k letters are outside(A, i, len) * w * inside(B, i, k) * inside(C, i + k, len - k) / Z,
+//where Z is inside of the starting symbol over the whole word
+double InsideOutside::addCounts(const char* word, unsigned length, std::vector<double>& counts) {
+	n = length;
+	const symbol start = index.startingSymbol();
+	if (start >= ntCount)
+		return -std::numeric_limits<double>::infinity();
+	if (n == 0) {
+		if (emptyRule == NO_RULE)
+			return -std::numeric_limits<double>::infinity();
+		counts[emptyRule] += 1.0;
+		return std::log(weights[emptyRule]);
+	}
+	fillInside(word);
+	const size_t whole = cellIndex(0, n);
+	const double total = inside[whole * ntCount + start];
+	if (insideExponent[whole] == EMPTY_CELL || total == 0.0)
+		return -std::numeric_limits<double>::infinity();
+	const int totalExponent = insideExponent[whole];
+	fillOutside();
+
+	for (unsigned i = 0; i < n; i++) {
+		const size_t cell = cellIndex(i, 1);
+		if (outsideExponent[cell] == EMPTY_CELL)
+			continue;
+		const double scale = std::ldexp(1.0, outsideExponent[cell] - totalExponent) / total;
+		const symbol* head = index.terminalHeadsBegin(word[i]);
+		for (const unsigned* r = index.terminalRulesBegin(word[i]); r != index.terminalRulesEnd(word[i]); r++, head++)
+			counts[*r] += outside[cell * ntCount + *head] * weights[*r] * scale;
+	}
+	for (unsigned len = 2; len <= n; len++) {
+		for (unsigned i = 0; i + len <= n; i++) {
+			const size_t cell = cellIndex(i, len);
+			if (outsideExponent[cell] == EMPTY_CELL)
+				continue;
+			const double* parentValues = &outside[cell * ntCount];
+			for (unsigned k = 1; k < len; k++) {
+				const size_t left = cellIndex(i, k), right = cellIndex(i + k, len - k);
+				if (insideExponent[left] == EMPTY_CELL || insideExponent[right] == EMPTY_CELL)
+					continue;
+				const double scale = std::ldexp(1.0, outsideExponent[cell] + insideExponent[left] + insideExponent[right] - totalExponent) / total;
+				const double* rightValues = &inside[right * ntCount];
+				for (symbol first : present[left]) {
+					const double leftValue = inside[left * ntCount + first] * scale;
+					for (const CompiledGrammar::BinaryRule* rule = index.pairsOfBegin(first); rule != index.pairsOfEnd(first); rule++)
+						counts[rule->rule] += parentValues[rule->head] * leftValue * rightValues[rule->second] * weights[rule->rule];
+				}
+			}
+		}
+	}
+	return std::log(total) + totalExponent * std::log(2.0);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "BitKernel.h"
+#include "CompiledGrammar.h"
+#include "ProducitonRule.h"
+#include <vector>
+
+//Expected number of uses of every rule in the parse trees of a word, every tree counted with its probability - the E step of
+//inside-outside training of rule weights. Grammar has to be in Chomsky normal form.
+//Long words would underflow doubles, so every cell of the chart keeps mantissas of its values and one binary exponent:
+//value of (A, cell) is mantissa * 2^exponent[cell], with the biggest mantissa of the cell in [0.5, 1).
+//An object keeps its chart buffers between words, so one object should be used for many words on one thread.
+class InsideOutside {
+private:
+	static const int EMPTY_CELL;			//exponent of a cell in which every value is 0
+	const CompiledGrammar& index;
+	std::vector<double> weights;			//weights of rules, copied out of the rule store
+	unsigned emptyRule;						//S->@, or NO_RULE
+	unsigned n;
+	unsigned ntCount;
+	std::vector<double> inside;				//inside[cellIndex(i, len) * ntCount + A]
+	std::vector<double> outside;			//same layout as inside
+	std::vector<int> insideExponent;		//per cell
+	std::vector<int> outsideExponent;
+	std::vector<std::vector<symbol> > present;	//present[cell] = {A | inside of A in cell > 0}
+
+	//Span of len letters (1..n) starting at i, see spanCell
+	size_t cellIndex(unsigned i, unsigned len) const { return spanCell(n, i, len); }
+	size_t cellCount() const { return spanCellCount(n); }
+	void normalize(double* values, const std::vector<symbol>& nonZero, int& exponent) const;
+	void fillInside(const char* word);
+	void fillOutside();
+public:
+	static const unsigned NO_RULE = 0xFFFFFFFFu;
+
+	InsideOutside(const RuleStore& rules, const CompiledGrammar& index);
+
+	//Adds expected uses of every rule in trees of word to counts (indexed by rule) and returns natural logarithm of the
+	//total weight of its trees. Returns -infinity and adds nothing if word has no tree.
+	double addCounts(const char* word, unsigned length, std::vector<double>& counts);
+};
@@ -0,0 +1,79 @@
+#include "MappedFile.h"
+#include <cstring>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& fileName) : contents(nullptr), length(0), file(INVALID_HANDLE_VALUE), mapping(NULL), opened(false) {
+	file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+		return;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	opened = true;
+	if (length == 0) //empty files cannot be mapped but are still valid
+		return;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+		contents = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	opened = contents != nullptr;
+}
+
+MappedFile::~MappedFile() {
+	if (contents != nullptr)
+		UnmapViewOfFile(contents);
+	if (mapping != NULL)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const std::string& fileName) : contents(nullptr), length(0), descriptor(-1), opened(false) {
+	descriptor = ::open(fileName.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return;
+	struct stat info;
+	if (fstat(descriptor, &info) != 0)
+		return;
+	length = static_cast<size_t>(info.st_size);
+	opened = true;
+	if (length == 0) //empty files cannot be mapped but are still valid
+		return;
+	void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (mapped != MAP_FAILED) {
+		contents = static_cast<const char*>(mapped);
+		madvise(mapped, length, MADV_SEQUENTIAL);
+	}
+	opened = contents != nullptr;
+}
+
+MappedFile::~MappedFile() {
+	if (contents != nullptr)
+		munmap(const_cast<char*>(contents), length);
+	if (descriptor >= 0)
+		close(descriptor);
+}
+#endif
+
+std::vector<TextLine> splitLines(const char* data, size_t size) {
+	std::vector<TextLine> lines;
+	const char* cursor = data;
+	const char* end = data + size;
+	while (cursor < end) {
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+		if (lineEnd == nullptr)
+			lineEnd = end;
+		const char* last = lineEnd;
+		if (last > cursor && last[-1] == '\r')
+			last--;
+		lines.push_back({ cursor, static_cast<unsigned>(last - cursor) });
+		cursor = lineEnd + 1;
+	}
+	return lines;
+}
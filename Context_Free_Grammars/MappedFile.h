@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+//Read-only memory mapping of a whole file. Contents stay valid while the object lives.
+class MappedFile {
+private:
+	const char* contents;
+	size_t length;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int descriptor;
+#endif
+	bool opened;
+public:
+	explicit MappedFile(const std::string& fileName);
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator = (const MappedFile& other) = delete;
+	~MappedFile();
+
+	bool isOpen() const { return opened; }
+	const char* data() const { return contents; }
+	size_t size() const { return length; }
+};
+
+//View of one line inside a buffer, without the line break. No characters are copied.
+struct TextLine {
+	const char* data;
+	unsigned length;
+};
+
+//Splits buffer at '\n'. A '\r' before '\n' is not part of the line. Last line does not need a line break.
+std::vector<TextLine> splitLines(const char* data, size_t size);
@@ -0,0 +1,138 @@
+#include "ParseForest.h"
+#include <algorithm>
+#include <ostream>
+#include <unordered_map>
+
+//Nodes are discovered top-down from (S, 0, n). A rule A->BC with split k gives a packed node only if B derives the left part
+//and C the right part, so every kept node derives its span and takes part in some tree.
+ParseForest::ParseForest(const RuleStore& rules, const CompiledGrammar& index, const std::string& word)
+	: parsedWord(word), forestNodes(), forestPacked(), counts() {
+	const CYKRecognizer& cyk = *index.cykRecognizer(rules);
+	const unsigned n = static_cast<unsigned>(word.length());
+	const symbol start = index.startingSymbol();
+	if (n == 0) {
+		if (!cyk.emptyWordAccepted())
+			return;
+		forestNodes.push_back({ start, 0, 0, 0, 0 });
+		for (const unsigned* r = index.rulesOfBegin(start); r != index.rulesOfEnd(start); r++) {
+			if (rules[*r].product.size() == 1 && rules[*r].product[0] == EPSILON_SYMBOL)
+				forestPacked.push_back({ *r, 0, NO_NODE, NO_NODE });
+		}
+		forestNodes[0].packedEnd = forestPacked.size();
+		countTrees();
+		return;
+	}
+	std::vector<bitWord> chart;
+	cyk.fillChart(word.data(), n, chart);
+	if (!cyk.derives(chart, n, 0, n - 1, start))
+		return;
+
+	//key of node (A, i, len) -> id
+	std::unordered_map<unsigned long long, unsigned> ids;
+	auto nodeId = [&](symbol nt, unsigned i, unsigned length) {
+		unsigned long long key = (static_cast<unsigned long long>(nt) * (n + 1) + i) * (n + 1) + length;
+		auto found = ids.find(key);
+		if (found != ids.end())
+			return found->second;
+		unsigned id = forestNodes.size();
+		ids.emplace(key, id);
+		forestNodes.push_back({ nt, i, length, 0, 0 });
+		return id;
+	};
+	nodeId(start, 0, n);
+	for (unsigned id = 0; id < forestNodes.size(); id++) { //nodes are appended while the loop runs
+		const Node current = forestNodes[id];
+		forestNodes[id].packedBegin = forestPacked.size();
+		for (const unsigned* r = index.rulesOfBegin(current.nonTerminal); r != index.rulesOfEnd(current.nonTerminal); r++) {
+			const std::vector<symbol>& product = rules[*r].product;
+			if (current.length == 1) {
+				if (product.size() == 1 && product[0] == terminalSymbol(word[current.start]))
+					forestPacked.push_back({ *r, 0, NO_NODE, NO_NODE });
+				continue;
+			}
+			if (product.size() != 2)
+				continue;
+			for (unsigned k = 1; k < current.length; k++) {
+				if (cyk.derives(chart, n, current.start, k - 1, product[0]) &&
+					cyk.derives(chart, n, current.start + k, current.length - k - 1, product[1])) {
+					unsigned left = nodeId(product[0], current.start, k);
+					unsigned right = nodeId(product[1], current.start + k, current.length - k);
+					forestPacked.push_back({ *r, k, left, right });
+				}
+			}
+		}
+		forestNodes[id].packedEnd = forestPacked.size();
+	}
+	countTrees();
+}
+
+//Children span fewer letters than their parent, so counting nodes by increasing length sees children first
+void ParseForest::countTrees() {
+	counts.assign(forestNodes.size(), 0);
+	std::vector<unsigned> order(forestNodes.size());
+	for (unsigned id = 0; id < order.size(); id++)
+		order[id] = id;
+	std::sort(order.begin(), order.end(), [this](unsigned a, unsigned b) { return forestNodes[a].length < forestNodes[b].length; });
+	auto saturatingAdd = [](unsigned long long a, unsigned long long b) { return a > MANY_TREES - b ? MANY_TREES : a + b; };
+	auto saturatingMultiply = [](unsigned long long a, unsigned long long b) { return b != 0 && a > MANY_TREES / b ? MANY_TREES : a * b; };
+	for (unsigned id : order) {
+		unsigned long long total = 0;
+		for (unsigned p = forestNodes[id].packedBegin; p < forestNodes[id].packedEnd; p++) {
+			const Packed& way = forestPacked[p];
+			unsigned long long trees = way.left == NO_NODE ? 1 : saturatingMultiply(counts[way.left], counts[way.right]);
+			total = saturatingAdd(total, trees);
+		}
+		counts[id] = total;
+	}
+}
+
+void ParseForest::writeTree(std::ostream& os, unsigned long long index, const std::function<std::string(symbol)>& name) const {
+	if (recognized())
+		writeTree(os, 0, index, name);
+}
+
+//Tree number index of a node is found by skipping whole packed nodes, then split into indices of the two subtrees.
+//Saturated counts are bigger than every index asked for, so the arithmetic stays exact.
+void ParseForest::writeTree(std::ostream& os, unsigned node, unsigned long long index, const std::function<std::string(symbol)>& name) const {
+	const Node& current = forestNodes[node];
+	os << name(current.nonTerminal) << '(';
+	for (unsigned p = current.packedBegin; p < current.packedEnd; p++) {
+		const Packed& way = forestPacked[p];
+		if (way.left == NO_NODE) {
+			if (index == 0) {
+				os << (current.length == 0 ? '@' : parsedWord[current.start]) << ')';
+				return;
+			}
+			index--;
+			continue;
+		}
+		unsigned long long rightTrees = counts[way.right];
+		unsigned long long trees = counts[way.left] > MANY_TREES / rightTrees ? MANY_TREES : counts[way.left] * rightTrees;
+		if (index < trees) {
+			writeTree(os, way.left, index / rightTrees, name);
+			os << ' ';
+			writeTree(os, way.right, index % rightTrees, name);
+			os << ')';
+			return;
+		}
+		index -= trees;
+	}
+	os << ')';
+}
+
+void ParseForest::writeForest(std::ostream& os, const std::function<std::string(symbol)>& name) const {
+	for (unsigned id = 0; id < forestNodes.size(); id++) {
+		const Node& current = forestNodes[id];
+		os << '#' << id << ' ' << name(current.nonTerminal) << '[' << current.start << ',' << current.start + current.length << "] =";
+		for (unsigned p = current.packedBegin; p < current.packedEnd; p++) {
+			const Packed& way = forestPacked[p];
+			if (p != current.packedBegin)
+				os << " |";
+			if (way.left == NO_NODE)
+				os << ' ' << (current.length == 0 ? '@' : parsedWord[current.start]);
+			else
+				os << " #" << way.left << " #" << way.right;
+		}
+		os << '\n';
+	}
+}
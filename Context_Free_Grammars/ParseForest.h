@@ -0,0 +1,55 @@
+#pragma once
+#include "CompiledGrammar.h"
+#include "ProducitonRule.h"
+#include <string>
+#include <vector>
+
+//Shared packed parse forest (SPPF) of one word, built from a filled CYK chart. Every symbol node (A, start, length) is kept
+//once and lists its packed nodes - the ways A derives the span: a rule and a split point, with back-pointers to the two child
+//nodes. Only nodes reachable from the root are kept, so the forest has O(n^3 * |rules|) packed nodes even when the number of
+//trees is exponential. Trees are read out of the forest, recognition is not repeated.
+class ParseForest {
+public:
+	struct Node {
+		symbol nonTerminal;
+		unsigned start;
+		unsigned length;
+		unsigned packedBegin;	//packed nodes of node are [packedBegin, packedEnd)
+		unsigned packedEnd;
+	};
+	//Rule A->BC split after 'split' letters, or rule A->c / A->@ with no children
+	struct Packed {
+		unsigned rule;
+		unsigned split;
+		unsigned left;			//node ids, NO_NODE for A->c and A->@
+		unsigned right;
+	};
+	static const unsigned NO_NODE = 0xFFFFFFFFu;
+	static const unsigned long long MANY_TREES = ~0ULL; //tree counts saturate here
+private:
+	std::string parsedWord;
+	std::vector<Node> forestNodes;		//root is node 0
+	std::vector<Packed> forestPacked;
+	std::vector<unsigned long long> counts;	//trees of every node, saturating
+
+	void countTrees();
+	void writeTree(std::ostream& os, unsigned node, unsigned long long index, const std::function<std::string(symbol)>& name) const;
+public:
+	//Grammar has to be in Chomsky normal form (index.cykRecognizer(rules) is not nullptr)
+	ParseForest(const RuleStore& rules, const CompiledGrammar& index, const std::string& word);
+
+	const std::string& word() const { return parsedWord; }
+	bool recognized() const { return !forestNodes.empty(); }
+	size_t nodeCount() const { return forestNodes.size(); }
+	size_t packedCount() const { return forestPacked.size(); }
+	const Node& node(unsigned id) const { return forestNodes[id]; }
+	const Packed& packed(unsigned id) const { return forestPacked[id]; }
+	//MANY_TREES if there are at least that many
+	unsigned long long treeCount() const { return recognized() ? counts[0] : 0; }
+
+	//Writes tree number index (0 <= index < treeCount()) in bracketed form, i.e. S(A(a) B(b)). Trees are numbered in order
+	//of packed nodes, left subtree major.
+	void writeTree(std::ostream& os, unsigned long long index, const std::function<std::string(symbol)>& name) const;
+	//One line per node: #id A[i,j] = #left #right | ... for binary rules, or the letter / @ for the others
+	void writeForest(std::ostream& os, const std::function<std::string(symbol)>& name) const;
+};
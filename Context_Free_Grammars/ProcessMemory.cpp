@@ -0,0 +1,45 @@
+#include "ProcessMemory.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool readProcessMemory(ProcessMemory& memory) {
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return false;
+	memory.resident = counters.WorkingSetSize;
+	memory.peak = counters.PeakWorkingSetSize;
+	return true;
+}
+
+#else
+
+//statm holds sizes in pages: total, resident, ...
+bool readProcessMemory(ProcessMemory& memory) {
+	FILE* statm = std::fopen("/proc/self/statm", "r");
+	if (statm == nullptr)
+		return false;
+	unsigned long total, resident;
+	bool read = std::fscanf(statm, "%lu %lu", &total, &resident) == 2;
+	std::fclose(statm);
+	if (!read)
+		return false;
+	memory.resident = static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0 && static_cast<size_t>(usage.ru_maxrss) * 1024 >= memory.resident)
+		memory.peak = static_cast<size_t>(usage.ru_maxrss) * 1024; //ru_maxrss is in KiB
+	else
+		memory.peak = memory.resident;
+	return true;
+}
+
+#endif
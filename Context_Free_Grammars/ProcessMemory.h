@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+
+//Memory of the whole process in bytes, as the operating system sees it
+struct ProcessMemory {
+	size_t resident; //pages currently in physical memory (working set on Windows)
+	size_t peak; //highest resident size so far
+};
+
+//Returns false if the numbers could not be read
+bool readProcessMemory(ProcessMemory& memory);
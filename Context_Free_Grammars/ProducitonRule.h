@@ -1,12 +1,38 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <functional>
+#include "Symbol.h"
+#include "ChunkedVector.h"
 
 using std::string;
 
 struct ProductionRule {
 	//constructor
-	string nonTerminal;
-	std::vector<string> product;
+	symbol nonTerminal;
+	std::vector<symbol> product;
+	double weight = 1.0; //i.e. probability of the rule among rules of its non-terminal. Rules of unweighted grammars have 1.
 
-};
\ No newline at end of file
+};
+
+//Weight is not part of the rule's identity - a grammar has at most one rule with given non-terminal and product
+inline bool operator == (const ProductionRule& a, const ProductionRule& b) {
+	return a.nonTerminal == b.nonTerminal && a.product == b.product;
+}
+
+//Hash of non-terminal and whole product sequence
+struct ProductionRuleHash {
+	size_t operator()(const ProductionRule& rule) const {
+		size_t hash = std::hash<symbol>()(rule.nonTerminal);
+		for (symbol p : rule.product)
+			hash ^= std::hash<symbol>()(p) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		return hash;
+	}
+};
+
+//Rules of a grammar. Copies of a grammar share chunks of rules until one of them changes them.
+using RuleStore = ChunkedVector<ProductionRule>;
+
+inline size_t heapBytes(const ProductionRule& rule) {
+	return rule.product.capacity() * sizeof(symbol);
+}
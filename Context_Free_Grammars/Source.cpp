@@ -1,8 +1,67 @@
 #include "System.h"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const size_t SCRIPT_OUTPUT_BUFFER = 1 << 20;
+
+static bool inputIsTerminal() {
+#ifdef _WIN32
+	return _isatty(_fileno(stdin)) != 0;
+#else
+	return isatty(fileno(stdin)) != 0;
+#endif
+}
+
+//Usage: Context_Free_Grammars [--script <file>] [--json]
+//Commands are read from <file>, or from standard input. If they do not come from a console (script file or pipe) there is no prompt,
+//no colouring and output is buffered until the end, 'flush' or 'quit'. --json prints one JSON object per command.
+int main(int argc, char* argv[]) {
+	string scriptFile;
+	bool json = false;
+	for (int i = 1; i < argc; i++) {
+		string argument = argv[i];
+		if (argument == "--script" && i + 1 < argc) {
+			scriptFile = argv[++i];
+		}
+		else if (argument == "--json") {
+			json = true;
+		}
+		else {
+			cerr << "Unknown argument '" << argument << "'! Usage: " << argv[0] << " [--script <file>] [--json]" << '\n';
+			return 1;
+		}
+	}
+
+	std::ifstream script;
+	if (!scriptFile.empty()) {
+		script.open(scriptFile);
+		if (!script.good()) {
+			cerr << "Script '" << scriptFile << "' could not be opened!" << '\n';
+			return 1;
+		}
+	}
+	bool batch = !scriptFile.empty() || !inputIsTerminal() || json;
+
+	static char outputBuffer[SCRIPT_OUTPUT_BUFFER];
+	if (batch) {
+		//Must happen before anything is printed. Errors go to the same buffer so they stay in order with other messages.
+		std::ios::sync_with_stdio(false);
+		cout.rdbuf()->pubsetbuf(outputBuffer, sizeof(outputBuffer));
+		cin.tie(nullptr);
+		cerr.rdbuf(cout.rdbuf());
+		disableColoring();
+	}
 
-int main() {
 	System sys;
-	sys.opreate();
+	if (batch)
+		sys.setBatchMode(json);
+	if (script.is_open())
+		sys.opreate(script);
+	else
+		sys.opreate();
 	return 0;
 }
 
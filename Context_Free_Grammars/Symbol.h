@@ -0,0 +1,23 @@
+#pragma once
+
+//Every symbol of a grammar is a dense integer id. Non-terminals are numbered 0..N-1 by the grammar's SymbolTable.
+//Terminals are encoded directly by their character with TERMINAL_FLAG set, so they never collide with non-terminal ids
+//and need no table lookup. Textual names only appear when a grammar is read or written.
+using symbol = unsigned;
+
+const symbol TERMINAL_FLAG = 0x80000000u;
+const symbol NO_SYMBOL = 0xFFFFFFFFu;
+
+inline bool isTerminalSymbol(symbol s) {
+	return (s & TERMINAL_FLAG) != 0;
+}
+
+inline symbol terminalSymbol(char c) {
+	return TERMINAL_FLAG | static_cast<unsigned char>(c);
+}
+
+inline char terminalOf(symbol s) {
+	return static_cast<char>(s & 0xFF);
+}
+
+const symbol EPSILON_SYMBOL = TERMINAL_FLAG | '@';
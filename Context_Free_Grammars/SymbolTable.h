@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Symbol.h"
+#include "ChunkedVector.h"
+
+using std::string;
+
+//Maps names of non-terminals to dense ids and back. Both directions are O(1).
+//Copies of a table share their contents: names are kept in a ChunkedVector and ids in a hash map which copies share, plus a
+//small map of ids added since. The small map is merged into the shared one once it grows, so copying a table stays cheap.
+class SymbolTable {
+private:
+	static const size_t MERGE_AT = 256;
+	using IdMap = std::unordered_map<string, symbol>;
+
+	ChunkedVector<string> names;
+	std::shared_ptr<IdMap> sharedIds;
+	IdMap newIds;
+
+	void mergeNewIds() {
+		if (!sharedIds)
+			sharedIds = std::make_shared<IdMap>();
+		else if (sharedIds.use_count() > 1)
+			sharedIds = std::make_shared<IdMap>(*sharedIds);
+		sharedIds->insert(newIds.begin(), newIds.end());
+		newIds.clear();
+	}
+public:
+	//Returns id of name, adding it to the table if it is not there yet
+	symbol intern(const string& name) {
+		symbol found = find(name);
+		if (found != NO_SYMBOL)
+			return found;
+		symbol id = static_cast<symbol>(names.size());
+		names.push_back(name);
+		newIds.emplace(name, id);
+		if (newIds.size() >= MERGE_AT)
+			mergeNewIds();
+		return id;
+	}
+
+	//Returns NO_SYMBOL if name is not in the table
+	symbol find(const string& name) const {
+		auto found = newIds.find(name);
+		if (found != newIds.end())
+			return found->second;
+		if (sharedIds) {
+			found = sharedIds->find(name);
+			if (found != sharedIds->end())
+				return found->second;
+		}
+		return NO_SYMBOL;
+	}
+
+	void reserve(unsigned count) {
+		mergeNewIds();
+		sharedIds->reserve(count);
+	}
+
+	bool contains(const string& name) const { return find(name) != NO_SYMBOL; }
+	const string& name(symbol id) const { return names[id]; }
+	const string& operator[](symbol id) const { return names[id]; }
+	unsigned size() const { return static_cast<unsigned>(names.size()); }
+	bool empty() const { return names.empty(); }
+
+	MemoryUsage memoryUsage() const {
+		//Every map entry holds a node with the name and id, and the map holds one pointer per bucket
+		auto mapBytes = [](const IdMap& ids) {
+			size_t bytes = ids.bucket_count() * sizeof(void*);
+			for (const auto& entry : ids)
+				bytes += sizeof(IdMap::value_type) + sizeof(void*) + heapBytes(entry.first);
+			return bytes;
+		};
+		MemoryUsage usage = names.memoryUsage([](const string& name) { return heapBytes(name); });
+		usage.add(mapBytes(newIds), false);
+		if (sharedIds)
+			usage.add(mapBytes(*sharedIds), sharedIds.use_count() > 1);
+		return usage;
+	}
+};
@@ -1,63 +1,103 @@
 #include "System.h"
 
-const string BLACK_TEXT = "\x1B[30m";
-const string RED_TEXT = "\x1B[31m";
-const string GREEN_TEXT = "\x1B[32m";
-const string YELLOW_TEXT = "\x1B[33m";
-const string BLUE_TEXT = "\x1B[34m";
-const string MAGENTA_TEXT = "\x1B[35m";
-const string CYAN_TEXT = "\x1B[36m";
-const string WHITE_TEXT = "\x1B[37m";
-const string BRIGHT_BLACK_TEXT = "\x1B[90m";
-const string BRIGHT_RED_TEXT = "\x1B[91m";
-const string BRIGHT_GREEN_TEXT = "\x1B[92m";
-const string BRIGHT_YELLOW_TEXT = "\x1B[93m";
-const string BRIGHT_BLUE_TEXT = "\x1B[94m";
-const string BRIGHT_MAGENTA_TEXT = "\x1B[95m";
-const string BRIGHT_CYAN_TEXT = "\x1B[96m";
-const string BRIGHT_WHITE_TEXT = "\x1B[97m";
-const string RESET_COLORING = "\033[0m";
-
 bool System::isExisitngIndex(unsigned index) const {
-	return index >= 0 && index < numberOfGrammars;
+	return index < grammars.size() && (grammars[index] != nullptr || compositions[index] != nullptr);
+}
+
+//Returns id of new grammar. Ids are never reused, so an id keeps naming the same grammar until it is dropped.
+//Contents of gram are moved into the registry, nothing is copied.
+unsigned System::addGrammar(Grammar&& gram) {
+	unsigned id = grammars.size();
+	gram.set_id(id);
+	grammars.push_back(std::unique_ptr<Grammar>(new Grammar(std::move(gram)))); //only the pointer is moved when registry grows
+	compositions.push_back(nullptr);
+	cout << GREEN_TEXT << "Grammar with id '" << id << "' was added!" << RESET_COLORING << '\n';
+	return id;
+}
+
+unsigned System::addComposition(std::shared_ptr<const Composition> node) {
+	unsigned id = grammars.size();
+	grammars.push_back(nullptr);
+	compositions.push_back(std::move(node));
+	cout << GREEN_TEXT << "Grammar with id '" << id << "' was added!" << RESET_COLORING << '\n';
+	return id;
+}
+
+//Grammar with its rules. A lazy grammar is flattened here, once, and stays flattened.
+Grammar& System::grammar(unsigned id) {
+	if (compositions[id] != nullptr) {
+		grammars[id].reset(new Grammar(*compositions[id]));
+		grammars[id]->set_id(id);
+		compositions[id].reset();
+	}
+	return *grammars[id];
+}
+
+//Node of grammar id for a new composition. Grammar with rules becomes a leaf holding a copy, which shares its rules,
+//so later changes to the grammar do not change compositions made from it.
+std::shared_ptr<const Composition> System::composition(unsigned id) const {
+	if (compositions[id] != nullptr)
+		return compositions[id];
+	return Composition::leaf(std::make_shared<const Grammar>(*grammars[id]));
+}
+
+bool System::compose(Composition::Kind kind, const vector<unsigned>& ids, const string& operation, unsigned& newId) {
+	vector<std::shared_ptr<const Composition> > operands;
+	for (unsigned id : ids)
+		operands.push_back(composition(id));
+	for (const auto& operand : operands) {
+		if (!operands[0]->sameTerminals(*operand)) {
+			cerr << RED_TEXT << "Cannot perform '" << operation << "' operation on grammars with different terminal sets!" << RESET_COLORING << '\n';
+			return false;
+		}
+	}
+	std::shared_ptr<const Composition> node = Composition::combine(kind, operands);
+	if (node == nullptr) {
+		cerr << RED_TEXT << "Result of '" << operation << "' would have too many non-terminals!" << RESET_COLORING << '\n';
+		return false;
+	}
+	newId = addComposition(std::move(node));
+	return true;
 }
 
-//Returns id of new grammar
-unsigned System::addGrammar(const Grammar& gram) {
-	if (numberOfGrammars + 1 >= capacity)
-		resize();
-	grammars[numberOfGrammars] = gram;
-	grammars[numberOfGrammars].set_id(numberOfGrammars);
-	cout << GREEN_TEXT << "Grammar with id '" << grammars[numberOfGrammars].get_id() << "' was added!" << RESET_COLORING << endl;
-	numberOfGrammars++;
-	return grammars[numberOfGrammars - 1].get_id();
+void System::printRecognition(unsigned id, const string& word, bool recognized) const {
+	if (recognized)
+		cout << BRIGHT_GREEN_TEXT << "Word '" << word << "' is recognized by Grammar<" << id << ">!" << RESET_COLORING << '\n';
+	else
+		cout << BRIGHT_RED_TEXT << "Word '" << word << "' is NOT recognized by Grammar<" << id << ">!" << RESET_COLORING << '\n';
 }
 
-void System::resize() {
-	Grammar* newGrammars = new Grammar[capacity * RESIZE_FACTOR];
-	capacity *= 2;
-	for (int i = 0; i < numberOfGrammars; i++) {
-		newGrammars[i] = grammars[i];
+//Reports every operand grammar of composition id which cannot be used with recognizer once, by its id
+bool System::prepareComposition(unsigned id, Composition::Recognizer recognizer) const {
+	vector<unsigned> notChomsky;
+	bool ready = compositions[id]->prepare(recognizer, notChomsky);
+	for (unsigned operand : notChomsky) {
+		cerr << RED_TEXT << "Grammar<" << operand << "> is not in Chomsky Normal Form. Algorithm CYK cannot be executed on Grammar<" << id << ">.\n" <<
+								"You can use 'chomskify' command to make grammar in Chomsky Normal Form." << RESET_COLORING << '\n';
 	}
-	delete[] grammars;
-	grammars = newGrammars;
+	return ready;
 }
 
+//Whole file is mapped at once. Rule lines are parsed in parallel against the symbols read from the header,
+//then added in the order they appear in the file.
 void System::open(const string& fileName) {
-	std::ifstream ifs(fileName);
+	MappedFile file(fileName);
 
-	if (ifs.good()) {
-		cout << GREEN_TEXT << "File located at '" << fileName << "' was opened!" << RESET_COLORING << endl;
+	if (file.isOpen()) {
+		cout << GREEN_TEXT << "File located at '" << fileName << "' was opened!" << RESET_COLORING << '\n';
 		//objects needed for grammar constructor
 		vector<string> nonTerminals;
 		vector<char> terminals;
 		string startingSymbol;
 		vector<ProductionRule> rules;
 
-		string temp; 
+		vector<TextLine> lines = splitLines(file.data(), file.size());
+		auto lineAt = [&lines](size_t i) {
+			return i < lines.size() ? string(lines[i].data, lines[i].length) : string();
+		};
 
 		//Read NTs
-		getline(ifs, temp);
+		string temp = lineAt(0);
 		string tempNT = "";
 		for (const auto& ch : temp) {
 			if (ch == ',') {
@@ -74,7 +114,7 @@ void System::open(const string& fileName) {
 		nonTerminals.push_back(tempNT); // Add last NT
 
 		//Read Ts
-		getline(ifs, temp);
+		temp = lineAt(1);
 		char tempT = '\0';
 		for (const auto& ch : temp) {
 			if (ch == ',') {
@@ -90,279 +130,673 @@ void System::open(const string& fileName) {
 		terminals.push_back(tempT); // Add last T
 
 		//Read Starting symbol
-		getline(ifs, startingSymbol);
+		startingSymbol = lineAt(2);
 		
 		//Create Grammar
-		Grammar* g = new Grammar(nonTerminals, terminals, rules, startingSymbol, numberOfGrammars);
-		while (getline(ifs, temp)) {
-			if (!temp.empty()) {
-				if (!g->addRule(temp, false)) { //addRule return false if not succesful
-					cout << BRIGHT_BLUE_TEXT << "Line '" << temp << "' is invalid rule and was ignored!" << RESET_COLORING << endl;
-				}
+		Grammar g(nonTerminals, terminals, rules, startingSymbol, grammars.size());
 
-			}
+		//Parse rules. Grammar is only read here, so chunks of lines can be parsed on different threads.
+		const size_t firstRule = std::min<size_t>(3, lines.size());
+		const size_t rulesCount = lines.size() - firstRule;
+		vector<ProductionRule> parsed(rulesCount);
+		vector<char> valid(rulesCount, 0);
+		vector<string> errors(rulesCount);
+		ThreadPool pool(rulesCount >= 2 * PARALLEL_LOAD_GRAIN ? ThreadPool::hardwareWorkers() : 1);
+		pool.parallelFor(0, rulesCount, PARALLEL_LOAD_GRAIN, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const TextLine& line = lines[firstRule + i];
+				if (line.length != 0)
+					valid[i] = g.parseRule(string(line.data, line.length), parsed[i], errors[i]);
+			}
+		});
 
+		//Merge in file order
+		for (size_t i = 0; i < rulesCount; i++) {
+			const TextLine& line = lines[firstRule + i];
+			if (line.length == 0)
+				continue;
+			if (!valid[i]) {
+				cout << BRIGHT_BLUE_TEXT << "Line " << firstRule + i + 1 << " '" << string(line.data, line.length) << "' is invalid rule and was ignored! " << errors[i] << RESET_COLORING << '\n';
+			}
+			else if (!g.addRule(parsed[i])) {
+				cout << BRIGHT_BLUE_TEXT << "Line " << firstRule + i + 1 << " '" << string(line.data, line.length) << "' is a duplicate rule and was ignored!" << RESET_COLORING << '\n';
+			}
 		}
-		addGrammar(*g);
+		addGrammar(std::move(g));
 	}
 	else {
-		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << endl;
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
 	}
-	ifs.close();
 }
 
 void System::save(unsigned id, const string& fileName) {
 	if (std::ifstream(fileName).good()) {
 		std::ofstream ofs(fileName);
-		grammars[id].save(ofs);
+		grammar(id).save(ofs);
 		ofs.close();
-		cout << GREEN_TEXT << "Grammar with id '"<< id << "' was saved in '" << fileName << "'!" << RESET_COLORING << endl;
+		cout << GREEN_TEXT << "Grammar with id '"<< id << "' was saved in '" << fileName << "'!" << RESET_COLORING << '\n';
 	}
 	else {
-		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << endl;
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
 		return;
 	}
 
 }
 
-System::System(): capacity(INITIAL_CAPACITY), numberOfGrammars(0), grammars(nullptr) {
-	grammars = new Grammar[capacity];
-}
-
-void System::opreate() {
-
-	const string openRegExpr = R"(^open \"((?:[^\"\s]|[ ])+)|(\"([^\"]+)\")\"$)";
-	const string saveRegExpr = R"(^save ([1-9]\d*|0) \"((?:[^\"\s]|[ ])+)|(\"([^\"]+)\")\"$)";
-	const string listRegExpr = R"(^list$)";
-	const string quitRegExpr = R"(^quit$)";
-	const string printRegExpr = R"(^print ([1-9]\d*|0)$)";
-	const string addRuleRegExpr = R"(^add rule ([1-9]\d*|0) \"([\w\->]+)\"$)";
-	const string removeRuleRegExpr = R"(^remove rule ([1-9]\d*|0) ([1-9]\d*|0)$)";
-	const string unionRegExpr = R"(^union ([1-9]\d*|0) ([1-9]\d*|0)$)";
-	const string concatRegExpr = R"(^concat ([1-9]\d*|0) ([1-9]\d*|0)$)";
-	const string iterRegExpr = R"(^iter ([1-9]\d*|0)$)";
-	const string chomskyRegExpr = R"(^chomsky ([1-9]\d*|0)$)";
-	const string chomskifyRegExpr = R"(^chomskify ([1-9]\d*|0)$)";
-	const string emptyRegExpr = R"(^empty ([1-9]\d*|0)$)";
-	const string CYKRegExpr = R"(^CYK ([1-9]\d*|0) \"([a-z\d]+)\"$)";
-	const string commandsRegExpr = R"(^commands$)";
-	const string copyRegExpr = R"(^copy ([1-9]\d*|0)$)";
-
-	const regex openPattern = regex(openRegExpr);
-	const regex savePattern = regex(saveRegExpr);
-	const regex listPattern = regex(listRegExpr);
-	const regex quitPattern = regex(quitRegExpr);
-	const regex printPattern = regex(printRegExpr);
-	const regex addRulePattern = regex(addRuleRegExpr);
-	const regex removeRulePattern = regex(removeRuleRegExpr);
-	const regex unionPattern = regex(unionRegExpr);
-	const regex concatPattern = regex(concatRegExpr);
-	const regex iterPattern = regex(iterRegExpr);
-	const regex chomskyPattern = regex(chomskyRegExpr);
-	const regex chomskifyPattern = regex(chomskifyRegExpr);
-	const regex emptyPattern = regex(emptyRegExpr);
-	const regex CYKPattern = regex(CYKRegExpr);
-	const regex commandsPattern = regex(commandsRegExpr);
-	const regex copyPattern = regex(copyRegExpr);
-
-	sregex_iterator iter;
-	const sregex_iterator end; //end-of-sequence iterator used to determine whether matches were found
-	string command;
-	while (true) {
+void System::openBinary(const string& fileName) {
+	MappedFile file(fileName);
+	if (!file.isOpen()) {
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
+		return;
+	}
+	Grammar g;
+	if (!g.loadBinary(file.data(), file.size())) {
+		cerr << RED_TEXT << "File located at '" << fileName << "' is not a binary grammar or is corrupted!" << RESET_COLORING << '\n';
+		return;
+	}
+	cout << GREEN_TEXT << "File located at '" << fileName << "' was opened!" << RESET_COLORING << '\n';
+	addGrammar(std::move(g));
+}
 
-		cout << '>';
-		getline(cin, command);
-		if ((iter = sregex_iterator(command.begin(), command.end(), quitPattern)) != end) { //quit
-			break;
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), openPattern)) != end) { // open
-			string fileName = (*iter)[1];
-			open(fileName);
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), savePattern)) != end) { //save
-			unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id "<< id << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				string fileName = (*iter)[2];
-				save(id, fileName);
-			}
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), listPattern)) != end) { // list
-			if (numberOfGrammars == 0) {
-				cerr << RED_TEXT << "No grammar exists!" << RESET_COLORING << endl;
-			}
-			else {
-				cout << CYAN_TEXT << "List of ids:" << RESET_COLORING << endl;
-				for (int i = 0; i < numberOfGrammars; i++) {
-					cout << CYAN_TEXT << grammars[i].get_id() << RESET_COLORING << endl;
-				}
-			}
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), printPattern)) != end) { // print
-			unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				grammars[id].print();
-			}
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), addRulePattern)) != end) {  // add rule
-			unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				string rule = (*iter)[2];
-				grammars[id].addRule(rule);
-			}
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), removeRulePattern)) != end) {  // remove rule
-			unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				unsigned ruleId = std::stoi((*iter)[2]);
-				grammars[id].removeRule(ruleId);
-			}	
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), unionPattern)) != end) {  // union
-			unsigned id1 = std::stoi((*iter)[1]);
-			unsigned id2 = std::stoi((*iter)[2]);
-			if (!isExisitngIndex(id1)) {
-				cerr << RED_TEXT << "Grammar with id " << id1 << " does not exist!" << RESET_COLORING << endl;
-			}
-			else if (!isExisitngIndex(id2)) {
-				cerr << RED_TEXT << "Grammar with id " << id2 << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				unsigned newId = addGrammar(grammars[id1].Union(grammars[id2]));
-				cout << GREEN_TEXT << "Union of grammars '"<< id1 << "' & '"<< id2 <<"' was created and saved with id '"<< newId <<"'!" << RESET_COLORING << endl;
-			}
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), concatPattern)) != end) {  // concat
-			unsigned id1 = std::stoi((*iter)[1]);
-			unsigned id2 = std::stoi((*iter)[2]);
-			if (!isExisitngIndex(id1)) {
-				cerr << RED_TEXT << "Grammar with id " << id1 << " does not exist!" << RESET_COLORING << endl;
-			}
-			else if (!isExisitngIndex(id2)) {
-				cerr << RED_TEXT << "Grammar with id " << id2 << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				unsigned newId = addGrammar(grammars[id1].Concat(grammars[id2]));
-				cout << GREEN_TEXT << "Concatenation of grammars '" << id1 << "' & '" << id2 << "' was created and saved with id '" << newId << "'!" << RESET_COLORING << endl;
-			}
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), iterPattern)) != end) {  // iter
-			unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				unsigned newId = addGrammar(grammars[id].Iter());
-				cout << GREEN_TEXT << "Iteration of grammar '" << id <<"' was created and saved with id '" << newId << "'!" << RESET_COLORING << endl;
-			}
-		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), chomskifyPattern)) != end) {  // chomskify
-			unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				grammars[id].Chomskify();
-				cout << GREEN_TEXT << "Grammar with '" << id << "' was converted to Chomsky normal form!" << RESET_COLORING << endl;
-			}
+//Unlike 'save' the file is created if it does not exist
+void System::saveBinary(unsigned id, const string& fileName) {
+	std::ofstream ofs(fileName, std::ios::binary);
+	if (!ofs.good()) {
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
+		return;
+	}
+	grammar(id).saveBinary(ofs);
+	ofs.close();
+	cout << GREEN_TEXT << "Grammar with id '" << id << "' was saved in binary format in '" << fileName << "'!" << RESET_COLORING << '\n';
+}
+
+//Results file gets one line per corpus line: '1' if word was recognized, '0' otherwise
+void System::cykBatch(unsigned id, const string& corpusFile, const string& resultsFile, unsigned threads) {
+	auto started = std::chrono::steady_clock::now();
+	MappedFile corpus(corpusFile);
+	if (!corpus.isOpen()) {
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
+		return;
+	}
+	vector<TextLine> words = splitLines(corpus.data(), corpus.size());
+	vector<char> accepted;
+	const std::shared_ptr<const Composition>& lazy = compositions[id];
+	if (lazy != nullptr) {
+		if (!prepareComposition(id, Composition::Recognizer::CYK))
+			return;
+		accepted.assign(words.size(), 0);
+		ThreadPool pool(threads);
+		pool.parallelFor(0, words.size(), 256, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				accepted[i] = lazy->recognize(string(words[i].data, words[i].length), Composition::Recognizer::CYK) ? 1 : 0;
+		});
+	}
+	else if (!grammars[id]->CYKBatch(words, accepted, threads)) {
+		return;
+	}
+
+	string results;
+	results.reserve(words.size() * 2);
+	size_t acceptedCount = 0;
+	for (char a : accepted) {
+		results += a ? '1' : '0';
+		results += '\n';
+		acceptedCount += a;
+	}
+	std::ofstream ofs(resultsFile, std::ios::binary);
+	if (!ofs.good()) {
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
+		return;
+	}
+	ofs.write(results.data(), results.size());
+	ofs.close();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	cout << GREEN_TEXT << "Checked " << words.size() << " words with grammar '" << id << "' on " << threads << " threads: " << acceptedCount << " recognized, "
+		<< words.size() - acceptedCount << " not recognized. Results were saved in '" << resultsFile << "'!" << RESET_COLORING << '\n';
+	cout << CYAN_TEXT << "Throughput: " << (seconds > 0 ? words.size() / seconds : 0.0) << " words/s (" << seconds << " s)" << RESET_COLORING << '\n';
+}
+
+void System::ambiguityBatch(unsigned id, const string& corpusFile, unsigned top, unsigned threads) {
+	auto started = std::chrono::steady_clock::now();
+	MappedFile corpus(corpusFile);
+	if (!corpus.isOpen()) {
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
+		return;
+	}
+	vector<TextLine> words = splitLines(corpus.data(), corpus.size());
+	if (!grammar(id).AmbiguityBatch(words, top, threads))
+		return;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	cout << CYAN_TEXT << "Throughput: " << (seconds > 0 ? words.size() / seconds : 0.0) << " words/s (" << seconds << " s on " << threads << " threads)"
+		<< RESET_COLORING << '\n';
+}
+
+void System::train(unsigned id, const string& corpusFile, unsigned iterations, unsigned threads) {
+	auto started = std::chrono::steady_clock::now();
+	MappedFile corpus(corpusFile);
+	if (!corpus.isOpen()) {
+		cerr << RED_TEXT << "File could not be opened! Check if path is correct!" << RESET_COLORING << '\n';
+		return;
+	}
+	vector<TextLine> words = splitLines(corpus.data(), corpus.size());
+	if (!grammar(id).Train(words, iterations, threads))
+		return;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	cout << CYAN_TEXT << "Training took " << seconds << " s on " << threads << " threads." << RESET_COLORING << '\n';
+}
+
+void System::generate(unsigned id, unsigned length, unsigned count, unsigned seed, const string& outputFile, unsigned threads) {
+	auto started = std::chrono::steady_clock::now();
+	if (!grammar(id).Generate(length, count, seed, outputFile, threads))
+		return;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	cout << GREEN_TEXT << "Words were saved in '" << outputFile << "'!" << RESET_COLORING << '\n';
+	cout << CYAN_TEXT << "Throughput: " << (seconds > 0 ? count / seconds : 0.0) << " words/s (" << seconds << " s on " << threads << " threads)"
+		<< RESET_COLORING << '\n';
+}
+
+void System::enumerate(unsigned id, unsigned maxLength, const string& outputFile, unsigned threads) {
+	auto started = std::chrono::steady_clock::now();
+	if (!grammar(id).Enumerate(maxLength, outputFile, threads))
+		return;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	cout << GREEN_TEXT << "Words were saved in '" << outputFile << "'!" << RESET_COLORING << '\n';
+	cout << CYAN_TEXT << "Took " << seconds << " s on " << threads << " threads." << RESET_COLORING << '\n';
+}
+
+System::System(): grammars(), compositions(), running(false),
+	interactive(true), jsonLines(false), commandsRun(0) {
+	using Kind = ArgumentKind;
+	addCommand("quit", {}, &System::quitCommand);
+	addCommand("open", { Kind::PATH }, &System::openCommand);
+	addCommand("save", { Kind::GRAMMAR_ID, Kind::PATH }, &System::saveCommand);
+	addCommand("open-bin", { Kind::PATH }, &System::openBinaryCommand);
+	addCommand("save-bin", { Kind::GRAMMAR_ID, Kind::PATH }, &System::saveBinaryCommand);
+	addCommand("list", {}, &System::listCommand);
+	addCommand("print", { Kind::GRAMMAR_ID }, &System::printCommand);
+	addCommand("add rule", { Kind::GRAMMAR_ID, Kind::RULE }, &System::addRuleCommand);
+	addCommand("remove rule", { Kind::GRAMMAR_ID, Kind::NUMBER }, &System::removeRuleCommand);
+	addCommand("union", { Kind::GRAMMAR_ID, Kind::GRAMMAR_ID }, &System::unionCommand);
+	addCommand("concat", { Kind::GRAMMAR_ID, Kind::GRAMMAR_ID }, &System::concatCommand);
+	addCommand("iter", { Kind::GRAMMAR_ID }, &System::iterCommand);
+	addCommand("union-all", { Kind::GRAMMAR_IDS }, &System::unionAllCommand);
+	addCommand("concat-all", { Kind::GRAMMAR_IDS }, &System::concatAllCommand);
+	addCommand("chomskify", { Kind::GRAMMAR_ID }, &System::chomskifyCommand);
+	addCommand("chomsky", { Kind::GRAMMAR_ID }, &System::chomskyCommand);
+	addCommand("empty", { Kind::GRAMMAR_ID }, &System::emptyCommand);
+	addCommand("reduce", { Kind::GRAMMAR_ID }, &System::reduceCommand);
+	addCommand("CYK", { Kind::GRAMMAR_ID, Kind::WORD, Kind::THREADS }, &System::CYKCommand);
+	addCommand("cyk-words", { Kind::GRAMMAR_ID, Kind::WORDS }, &System::CYKWordsCommand);
+	addCommand("cyk-prefixes", { Kind::GRAMMAR_ID, Kind::WORD }, &System::CYKPrefixesCommand);
+	addCommand("earley", { Kind::GRAMMAR_ID, Kind::WORD }, &System::earleyCommand);
+	addCommand("parse", { Kind::GRAMMAR_ID, Kind::WORD }, &System::parseCommand);
+	addCommand("parse-trees", { Kind::GRAMMAR_ID, Kind::WORD, Kind::NUMBER }, &System::parseTreesCommand);
+	addCommand("parse-forest", { Kind::GRAMMAR_ID, Kind::WORD }, &System::parseForestCommand);
+	addCommand("ambiguity", { Kind::GRAMMAR_ID, Kind::WORD }, &System::ambiguityCommand);
+	addCommand("ambiguity-exact", { Kind::GRAMMAR_ID, Kind::WORD }, &System::ambiguityExactCommand);
+	addCommand("ambiguity-batch", { Kind::GRAMMAR_ID, Kind::PATH, Kind::NUMBER, Kind::THREADS }, &System::ambiguityBatchCommand);
+	addCommand("viterbi", { Kind::GRAMMAR_ID, Kind::WORD, Kind::BEAM }, &System::viterbiCommand);
+	addCommand("train", { Kind::GRAMMAR_ID, Kind::PATH, Kind::ITERATIONS, Kind::THREADS }, &System::trainCommand);
+	addCommand("generate", { Kind::GRAMMAR_ID, Kind::LENGTH, Kind::COUNT, Kind::PATH, Kind::SEED, Kind::THREADS }, &System::generateCommand);
+	addCommand("enumerate", { Kind::GRAMMAR_ID, Kind::LENGTH, Kind::PATH, Kind::THREADS }, &System::enumerateCommand);
+	addCommand("cyk-batch", { Kind::GRAMMAR_ID, Kind::PATH, Kind::PATH, Kind::THREADS }, &System::CYKBatchCommand);
+	addCommand("copy", { Kind::GRAMMAR_ID }, &System::copyCommand);
+	addCommand("drop", { Kind::GRAMMAR_ID }, &System::dropCommand);
+	addCommand("mem", {}, &System::memCommand);
+#ifdef DISPATCH_BENCH
+	addCommand("bench-dispatch", { Kind::NUMBER }, &System::benchDispatchCommand);
+#endif
+	addCommand("flush", {}, &System::flushCommand);
+	addCommand("commands", {}, &System::commandsCommand);
+}
+
+void System::addCommand(const string& keyword, const vector<ArgumentKind>& arguments, CommandHandler handler) {
+	unsigned index = parser.add(keyword, arguments);
+	if (handlers.size() <= index)
+		handlers.resize(index + 1);
+	handlers[index] = handler;
+}
+
+//Returns false if line is not a command. Handlers are only called once every grammar id in the line exists.
+bool System::dispatch(const string& line) {
+	ParsedCommand parsed;
+	if (!parser.parse(line, parsed))
+		return false;
+	for (unsigned id : parsed.ids) {
+		if (!isExisitngIndex(id)) {
+			cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << '\n';
+			return true;
 		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), chomskyPattern)) != end) {  // chomsky
-			unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
+	}
+	(this->*handlers[parsed.command])(parsed);
+	return true;
+}
+
+static string jsonString(const string& text) {
+	string result = "\"";
+	for (char c : text) {
+		switch (c) {
+		case '"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				const char* hex = "0123456789abcdef";
+				result += "\\u00";
+				result += hex[(c >> 4) & 0xF];
+				result += hex[c & 0xF];
 			}
 			else {
-				if (grammars[id].Chomsky())
-					cout << BRIGHT_GREEN_TEXT << "Grammar with '" << id << "' is in Chomsky normal form!" << RESET_COLORING << endl;
-				else
-					cout << BRIGHT_RED_TEXT << "Grammar with '" << id << "' is NOT in Chomsky normal form!" << RESET_COLORING << endl;
+				result += c;
 			}
 		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), emptyPattern)) != end) {  // empty
-		unsigned id = std::stoi((*iter)[1]);
-		if (!isExisitngIndex(id)) {
-			cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
-		}
-		else {
-			if (grammars[id].Empty())
-				cout << BRIGHT_GREEN_TEXT << "Language of grammar with '" << id << "' is empty!" << RESET_COLORING << endl;
-			else
-				cout << BRIGHT_RED_TEXT << "Language of grammar with '" << id << "' is NOT empty!" << RESET_COLORING << endl;
-		}
+	}
+	return result + '"';
+}
+
+//Output of the command is captured and written as {"id":..,"command":..,"valid":..,"result":..,"ms":..} on one line
+void System::dispatchAsJson(const string& line) {
+	std::ostringstream captured;
+	std::streambuf* outBuffer = cout.rdbuf(captured.rdbuf());
+	std::streambuf* errBuffer = cerr.rdbuf(captured.rdbuf());
+	auto started = std::chrono::steady_clock::now();
+	bool valid = dispatch(line);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+	if (!valid)
+		cerr << RED_TEXT << "Invalid command! Type 'commands' for list of available commands." << RESET_COLORING << '\n';
+	cout.rdbuf(outBuffer);
+	cerr.rdbuf(errBuffer);
+
+	string result = captured.str();
+	if (!result.empty() && result.back() == '\n')
+		result.pop_back();
+	cout << "{\"id\":" << ++commandsRun << ",\"command\":" << jsonString(line) << ",\"valid\":" << (valid ? "true" : "false")
+		<< ",\"result\":" << jsonString(result) << ",\"ms\":" << ms << "}\n";
+}
+
+void System::setBatchMode(bool jsonLines) {
+	interactive = false;
+	this->jsonLines = jsonLines;
+}
+
+void System::opreate(std::istream& in) {
+	string command;
+	running = true;
+	while (running) {
+
+		if (interactive)
+			cout << '>';
+		if (!getline(in, command))
+			break;
+		if (!command.empty() && command.back() == '\r') //scripts saved on Windows
+			command.pop_back();
+		if (jsonLines) {
+			dispatchAsJson(command);
 		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), CYKPattern)) != end) {  // CYK
-		unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				string word = (*iter)[2];
-				grammars[id].CYK(word);
-			}
+		else if (!dispatch(command)) {
+			cerr << RED_TEXT << "Invalid command! Type 'commands' for list of available commands." << RESET_COLORING << '\n';
 		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), copyPattern)) != end) {  // copy
-			unsigned id = std::stoi((*iter)[1]);
-			if (!isExisitngIndex(id)) {
-				cerr << RED_TEXT << "Grammar with id " << id << " does not exist!" << RESET_COLORING << endl;
-			}
-			else {
-				Grammar temp = grammars[id];
-				unsigned nId = addGrammar(temp);
-				cout << BRIGHT_CYAN_TEXT << "A copy of grammar with id '" << id << "' was created! New grammar has id '" << nId << "'." << RESET_COLORING << endl;
+	}
+	cout.flush();
+}
+
+void System::quitCommand(const ParsedCommand&) {
+	running = false;
+}
+
+void System::openCommand(const ParsedCommand& command) {
+	open(command.texts[0]);
+}
+
+void System::saveCommand(const ParsedCommand& command) {
+	save(command.ids[0], command.texts[0]);
+}
+
+void System::openBinaryCommand(const ParsedCommand& command) {
+	openBinary(command.texts[0]);
+}
+
+void System::saveBinaryCommand(const ParsedCommand& command) {
+	saveBinary(command.ids[0], command.texts[0]);
+}
+
+void System::listCommand(const ParsedCommand&) {
+	bool anyGrammar = false;
+	for (unsigned id = 0; id < grammars.size(); id++)
+		anyGrammar = anyGrammar || isExisitngIndex(id);
+	if (!anyGrammar) {
+		cerr << RED_TEXT << "No grammar exists!" << RESET_COLORING << '\n';
+	}
+	else {
+		static const char* const KIND_NAMES[] = { "grammar", "union", "concatenation", "iteration" };
+		cout << CYAN_TEXT << "List of ids:" << RESET_COLORING << '\n';
+		for (unsigned id = 0; id < grammars.size(); id++) {
+			if (compositions[id] != nullptr) {
+				const Composition& node = *compositions[id];
+				cout << CYAN_TEXT << id << BRIGHT_BLACK_TEXT << " (" << node.ruleCount() << " rules, lazy " << KIND_NAMES[static_cast<int>(node.kind())]
+					<< " of " << node.operands().size() << (node.operands().size() == 1 ? " grammar" : " grammars") << ")" << RESET_COLORING << '\n';
+			}
+			else if (grammars[id] != nullptr) {
+				MemoryUsage usage = grammars[id]->memoryUsage();
+				cout << CYAN_TEXT << id << BRIGHT_BLACK_TEXT << " (" << grammars[id]->getRules().size() << " rules, " << usage.owned / 1024 << " KiB own, "
+					<< usage.shared / 1024 << " KiB shared with other grammars)" << RESET_COLORING << '\n';
 			}
 		}
-		else if ((iter = sregex_iterator(command.begin(), command.end(), commandsPattern)) != end) { //commands
-			cout << BRIGHT_WHITE_TEXT << "List of available commands: " << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "1. open \"destination\" "<< BRIGHT_BLACK_TEXT <<
-				"- Opens a file located at \"destination\" and \n\tcreates new grammar in system with read parameters." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "2. save <id> \"destination\" " << BRIGHT_BLACK_TEXT <<
-				"- Saves grammar with <id> in flie located at \"destination\" ONLY if such file exists." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "3. list " << BRIGHT_BLACK_TEXT <<
-				"- Shows list of identifiers of existing grammars." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "4. print <id> " << BRIGHT_BLACK_TEXT <<
-				"- Prints grammar with identifier <id> if such exists." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "5. add rule <id> \"rule\" " << BRIGHT_BLACK_TEXT <<
-				"- Adds rule to grammar with identifier <id>. Rules should look like \"A->aA\"" << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "6. remove rule <id> <n> " << BRIGHT_BLACK_TEXT <<
-				"- Removes rule number <n> of grammar with identifier <id>." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "7. union <id1> <id2> " << BRIGHT_BLACK_TEXT <<
-				"- Creates new grammar which is union of grammars with identifiers <id1> & <id2>." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "8. union <id1> <id2> " << BRIGHT_BLACK_TEXT <<
-				"- Creates new grammar which is concatenation of grammars with identifiers <id1> & <id2>." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "9. iter <id> " << BRIGHT_BLACK_TEXT <<
-				"- Creates new grammar which is iteration of grammar with identifier <id>." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "10. chomsky <id> " << BRIGHT_BLACK_TEXT <<
-				"- Returns whether grammar with identifier <id> is in Chomsky normal form or not." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "11. chomskify <id> " << BRIGHT_BLACK_TEXT <<
-				"- Transforms grammar with identifier <id> in Chomsky normal form." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "12. empty <id> " << BRIGHT_BLACK_TEXT <<
-				"- Returns whether the language of grammar with identifier <id> is empty or not." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "13. CYK <id> \"alpha\" " << BRIGHT_BLACK_TEXT <<
-				"- Performs CYK algorithm over grammar with identifier <id> with the word \"alpha\"." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "14. copy <id> " << BRIGHT_BLACK_TEXT <<
-				"- Creates a new grammar - copy of grammar with identifier <id>." << RESET_COLORING << endl;
-			cout << BRIGHT_WHITE_TEXT << "\t" << "15. quit " << BRIGHT_BLACK_TEXT <<
-				"- Closes the program." << RESET_COLORING << endl;
-			cout << BRIGHT_YELLOW_TEXT << "Commands are case and space sensitive. A single difference from layout will result in unrecognized command." << endl
-				<< "Tip: Do not start commands with capital letter or put space after last expected character!" << RESET_COLORING << endl;
-		}
-		else {
-			cerr << RED_TEXT << "Invalid command! Type 'commands' for list of available commands." << RESET_COLORING << endl;
+	}
+}
+
+void System::printCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).print();
+}
+
+void System::addRuleCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).addRule(command.texts[0]);
+}
+
+void System::removeRuleCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).removeRule(command.numbers[0]);
+}
+
+void System::unionCommand(const ParsedCommand& command) {
+	unsigned id1 = command.ids[0];
+	unsigned id2 = command.ids[1];
+	unsigned newId;
+	if (!compose(Composition::Kind::UNION, { id1, id2 }, "union", newId))
+		return;
+	cout << GREEN_TEXT << "Union of grammars '"<< id1 << "' & '"<< id2 <<"' was created and saved with id '"<< newId <<"'!" << RESET_COLORING << '\n';
+}
+
+void System::concatCommand(const ParsedCommand& command) {
+	unsigned id1 = command.ids[0];
+	unsigned id2 = command.ids[1];
+	unsigned newId;
+	if (!compose(Composition::Kind::CONCAT, { id1, id2 }, "concat", newId))
+		return;
+	cout << GREEN_TEXT << "Concatenation of grammars '" << id1 << "' & '" << id2 << "' was created and saved with id '" << newId << "'!" << RESET_COLORING << '\n';
+}
+
+void System::iterCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	unsigned newId;
+	if (!compose(Composition::Kind::ITER, { id }, "iter", newId))
+		return;
+	cout << GREEN_TEXT << "Iteration of grammar '" << id <<"' was created and saved with id '" << newId << "'!" << RESET_COLORING << '\n';
+}
+
+//One node with every operand and one new starting symbol, instead of a chain of binary nodes. When it is flattened every
+//operand is renamed and copied once, with non-terminals and rules reserved up front.
+void System::unionAllCommand(const ParsedCommand& command) {
+	unsigned newId;
+	if (!compose(Composition::Kind::UNION, command.ids, "union-all", newId))
+		return;
+	cout << GREEN_TEXT << "Union of " << command.ids.size() << " grammars was created and saved with id '" << newId << "'!" << RESET_COLORING << '\n';
+}
+
+void System::concatAllCommand(const ParsedCommand& command) {
+	unsigned newId;
+	if (!compose(Composition::Kind::CONCAT, command.ids, "concat-all", newId))
+		return;
+	cout << GREEN_TEXT << "Concatenation of " << command.ids.size() << " grammars was created and saved with id '" << newId << "'!" << RESET_COLORING << '\n';
+}
+
+void System::chomskifyCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	grammar(id).Chomskify();
+	cout << GREEN_TEXT << "Grammar with '" << id << "' was converted to Chomsky normal form!" << RESET_COLORING << '\n';
+}
+
+void System::chomskyCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	if (grammar(id).Chomsky())
+		cout << BRIGHT_GREEN_TEXT << "Grammar with '" << id << "' is in Chomsky normal form!" << RESET_COLORING << '\n';
+	else
+		cout << BRIGHT_RED_TEXT << "Grammar with '" << id << "' is NOT in Chomsky normal form!" << RESET_COLORING << '\n';
+}
+
+void System::emptyCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	if (grammar(id).Empty())
+		cout << BRIGHT_GREEN_TEXT << "Language of grammar with '" << id << "' is empty!" << RESET_COLORING << '\n';
+	else
+		cout << BRIGHT_RED_TEXT << "Language of grammar with '" << id << "' is NOT empty!" << RESET_COLORING << '\n';
+}
+
+void System::reduceCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	Grammar& g = grammar(id);
+	unsigned nonTerminalsBefore = g.nonTerminalCount();
+	unsigned rulesBefore = g.getRules().size();
+	g.Reduce();
+	cout << GREEN_TEXT << "Grammar with '" << id << "' was reduced! Removed " << nonTerminalsBefore - g.nonTerminalCount()
+		<< " useless non-terminals and " << rulesBefore - g.getRules().size() << " rules." << RESET_COLORING << '\n';
+}
+
+void System::CYKCommand(const ParsedCommand& command) {
+	unsigned threads = command.threads != 0 ? command.threads : 1;
+	unsigned id = command.ids[0];
+	if (compositions[id] != nullptr) { //operands are asked directly, result is not flattened
+		if (!prepareComposition(id, Composition::Recognizer::CYK))
+			return;
+		std::unique_ptr<ThreadPool> pool;
+		if (threads > 1 && command.texts[0].length() >= PARALLEL_CYK_MIN_LENGTH)
+			pool.reset(new ThreadPool(threads));
+		printRecognition(id, command.texts[0], compositions[id]->recognize(command.texts[0], Composition::Recognizer::CYK, pool.get()));
+		return;
+	}
+	grammars[id]->CYK(command.texts[0], threads);
+}
+
+void System::CYKWordsCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	if (compositions[id] != nullptr) {
+		if (prepareComposition(id, Composition::Recognizer::CYK)) {
+			for (const string& word : command.texts)
+				printRecognition(id, word, compositions[id]->recognize(word, Composition::Recognizer::CYK));
 		}
+		return;
+	}
+	grammars[id]->CYKWords(command.texts);
+}
+
+void System::CYKPrefixesCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).CYKPrefixes(command.texts[0]);
+}
+
+void System::earleyCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	if (compositions[id] != nullptr) {
+		prepareComposition(id, Composition::Recognizer::EARLEY);
+		printRecognition(id, command.texts[0], compositions[id]->recognize(command.texts[0], Composition::Recognizer::EARLEY));
+		return;
 	}
+	grammars[id]->Earley(command.texts[0]);
+}
+
+void System::parseCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).Parse(command.texts[0], 1);
+}
+
+void System::parseTreesCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).Parse(command.texts[0], command.numbers[0]);
 }
 
-System::~System() {
-	delete[] grammars;
+void System::parseForestCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).PrintForest(command.texts[0]);
 }
+
+void System::ambiguityCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).Ambiguity(command.texts[0], false);
+}
+
+void System::ambiguityExactCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).Ambiguity(command.texts[0], true);
+}
+
+void System::ambiguityBatchCommand(const ParsedCommand& command) {
+	unsigned threads = command.threads != 0 ? command.threads : ThreadPool::hardwareWorkers();
+	ambiguityBatch(command.ids[0], command.texts[0], command.numbers[0], threads);
+}
+
+void System::viterbiCommand(const ParsedCommand& command) {
+	grammar(command.ids[0]).Viterbi(command.texts[0], command.beam);
+}
+
+void System::trainCommand(const ParsedCommand& command) {
+	unsigned threads = command.threads != 0 ? command.threads : ThreadPool::hardwareWorkers();
+	train(command.ids[0], command.texts[0], command.numbers[0], threads);
+}
+
+void System::generateCommand(const ParsedCommand& command) {
+	unsigned threads = command.threads != 0 ? command.threads : ThreadPool::hardwareWorkers();
+	generate(command.ids[0], command.numbers[0], command.numbers[1], command.seed, command.texts[0], threads);
+}
+
+void System::enumerateCommand(const ParsedCommand& command) {
+	unsigned threads = command.threads != 0 ? command.threads : ThreadPool::hardwareWorkers();
+	enumerate(command.ids[0], command.numbers[0], command.texts[0], threads);
+}
+
+void System::CYKBatchCommand(const ParsedCommand& command) {
+	unsigned threads = command.threads != 0 ? command.threads : ThreadPool::hardwareWorkers();
+	cykBatch(command.ids[0], command.texts[0], command.texts[1], threads);
+}
+
+//Chunks shared with copies and lazy compositions stay alive, so only memory the grammar owns alone is reported as freed
+void System::dropCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	if (compositions[id] != nullptr) {
+		compositions[id].reset();
+		cout << BRIGHT_CYAN_TEXT << "Grammar with id '" << id << "' was dropped! Its operands are freed once no other grammar uses them." << RESET_COLORING << '\n';
+		return;
+	}
+	MemoryUsage usage = grammars[id]->memoryUsage();
+	grammars[id].reset();
+	cout << BRIGHT_CYAN_TEXT << "Grammar with id '" << id << "' was dropped! " << usage.owned / 1024 << " KiB were freed";
+	if (usage.shared != 0)
+		cout << ", " << usage.shared / 1024 << " KiB are still shared with other grammars";
+	cout << '.' << RESET_COLORING << '\n';
+}
+
+//Footprint of the whole process next to what the grammars account for, so leaks show up as a growing difference
+void System::memCommand(const ParsedCommand&) {
+	ProcessMemory memory;
+	if (!readProcessMemory(memory)) {
+		cerr << RED_TEXT << "Memory usage of the process could not be read!" << RESET_COLORING << '\n';
+		return;
+	}
+	unsigned alive = 0;
+	size_t grammarBytes = 0;
+	for (unsigned id = 0; id < grammars.size(); id++) {
+		if (isExisitngIndex(id))
+			alive++;
+		if (grammars[id] != nullptr)
+			grammarBytes += grammars[id]->memoryUsage().owned;
+	}
+	cout << CYAN_TEXT << "Resident memory: " << memory.resident / 1024 << " KiB (peak " << memory.peak / 1024 << " KiB)" << RESET_COLORING << '\n';
+	cout << CYAN_TEXT << "Grammars: " << alive << " alive, " << grammarBytes / 1024 << " KiB not shared with other grammars" << RESET_COLORING << '\n';
+}
+
+void System::copyCommand(const ParsedCommand& command) {
+	unsigned id = command.ids[0];
+	unsigned nId = compositions[id] != nullptr ? addComposition(compositions[id]) : addGrammar(Grammar(*grammars[id]));
+	cout << BRIGHT_CYAN_TEXT << "A copy of grammar with id '" << id << "' was created! New grammar has id '" << nId << "'." << RESET_COLORING << '\n';
+}
+
+#ifdef DISPATCH_BENCH
+void System::benchDispatchCommand(const ParsedCommand& command) {
+	benchDispatch(parser, command.numbers[0]);
+}
+#endif
+
+void System::flushCommand(const ParsedCommand&) {
+	cout.flush();
+}
+
+void System::commandsCommand(const ParsedCommand&) {
+	cout << BRIGHT_WHITE_TEXT << "List of available commands: " << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "1. open \"destination\" "<< BRIGHT_BLACK_TEXT <<
+		"- Opens a file located at \"destination\" and \n\tcreates new grammar in system with read parameters." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "2. save <id> \"destination\" " << BRIGHT_BLACK_TEXT <<
+		"- Saves grammar with <id> in flie located at \"destination\" ONLY if such file exists." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "3. open-bin \"destination\" " << BRIGHT_BLACK_TEXT <<
+		"- Opens a grammar saved with 'save-bin' located at \"destination\"." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "4. save-bin <id> \"destination\" " << BRIGHT_BLACK_TEXT <<
+		"- Saves grammar with <id> in binary format in file located at \"destination\".\n\tBinary files load much faster than text ones." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "5. list " << BRIGHT_BLACK_TEXT <<
+		"- Shows list of identifiers of existing grammars with their memory use." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "6. print <id> " << BRIGHT_BLACK_TEXT <<
+		"- Prints grammar with identifier <id> if such exists." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "7. add rule <id> \"rule\" " << BRIGHT_BLACK_TEXT <<
+		"- Adds rule to grammar with identifier <id>. Rules should look like \"A->aA\",\n\toptionally followed by a weight, i.e. \"A->aA 0.25\"." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "8. remove rule <id> <n> " << BRIGHT_BLACK_TEXT <<
+		"- Removes rule number <n> of grammar with identifier <id>." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "9. union <id1> <id2> " << BRIGHT_BLACK_TEXT <<
+		"- Creates new grammar which is union of grammars with identifiers <id1> & <id2>.\n\tResults of union, concat and iter are kept lazy: their rules are only built when a command needs them,\n\tCYK and earley ask the operand grammars instead." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "10. concat <id1> <id2> " << BRIGHT_BLACK_TEXT <<
+		"- Creates new grammar which is concatenation of grammars with identifiers <id1> & <id2>." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "11. iter <id> " << BRIGHT_BLACK_TEXT <<
+		"- Creates new grammar which is iteration of grammar with identifier <id>." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "12. union-all <id1> <id2> ... <idN> " << BRIGHT_BLACK_TEXT <<
+		"- Creates new grammar which is union of all given grammars, with one new starting symbol." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "13. concat-all <id1> <id2> ... <idN> " << BRIGHT_BLACK_TEXT <<
+		"- Creates new grammar which is concatenation of all given grammars in order, with one new starting symbol." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "14. chomsky <id> " << BRIGHT_BLACK_TEXT <<
+		"- Returns whether grammar with identifier <id> is in Chomsky normal form or not." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "15. chomskify <id> " << BRIGHT_BLACK_TEXT <<
+		"- Transforms grammar with identifier <id> in Chomsky normal form." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "16. empty <id> " << BRIGHT_BLACK_TEXT <<
+		"- Returns whether the language of grammar with identifier <id> is empty or not." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "17. reduce <id> " << BRIGHT_BLACK_TEXT <<
+		"- Removes non-terminals of grammar with identifier <id> which derive no word or cannot be reached\n\tfrom the starting symbol, together with their rules." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "18. CYK <id> \"alpha\" [threads=<n>] " << BRIGHT_BLACK_TEXT <<
+		"- Performs CYK algorithm over grammar with identifier <id> with the word \"alpha\".\n\tLong words are checked on <n> threads if given." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "19. cyk-words <id> \"alpha\" \"beta\" ... " << BRIGHT_BLACK_TEXT <<
+		"- Performs CYK algorithm over grammar with identifier <id> with every given word.\n\tWords with common prefixes share the work on that prefix." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "20. cyk-prefixes <id> \"alpha\" " << BRIGHT_BLACK_TEXT <<
+		"- Shows whether every prefix of \"alpha\" is recognized by grammar with identifier <id>.\n\tChart is extended by one column per letter." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "21. earley <id> \"alpha\" " << BRIGHT_BLACK_TEXT <<
+		"- Performs Earley algorithm over grammar with identifier <id> with the word \"alpha\".\n\tGrammar does not need to be in Chomsky normal form." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "22. parse <id> \"alpha\" " << BRIGHT_BLACK_TEXT <<
+		"- Parses \"alpha\" with grammar with identifier <id> in Chomsky normal form. Shows number of parse trees and the first tree." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "23. parse-trees <id> \"alpha\" <k> " << BRIGHT_BLACK_TEXT <<
+		"- Shows first <k> parse trees of \"alpha\". Parse forest of last word is kept, so it is not parsed again." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "24. parse-forest <id> \"alpha\" " << BRIGHT_BLACK_TEXT <<
+		"- Shows whole shared parse forest of \"alpha\": one line per node with its alternatives." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "25. ambiguity <id> \"alpha\" " << BRIGHT_BLACK_TEXT <<
+		"- Counts parse trees of \"alpha\" in grammar with identifier <id> in Chomsky normal form and shows the smallest\n\tambiguous part of it. Counts stop growing at 2^64 - 1." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "26. ambiguity-exact <id> \"alpha\" " << BRIGHT_BLACK_TEXT <<
+		"- Same as ambiguity, with exact counts of any size." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "27. ambiguity-batch <id> \"corpus\" <k> [threads=<n>] " << BRIGHT_BLACK_TEXT <<
+		"- Counts parse trees of every line of file \"corpus\" in parallel and shows the <k> most ambiguous words." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "28. viterbi <id> \"alpha\" [beam=<k>] " << BRIGHT_BLACK_TEXT <<
+		"- Shows the most probable parse tree of \"alpha\" in weighted grammar with identifier <id> in Chomsky normal form.\n\tWith <k> only the <k> most probable non-terminals of every part of the word are kept - faster, but may miss the best tree." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "29. train <id> \"corpus\" iterations=<n> [threads=<n>] " << BRIGHT_BLACK_TEXT <<
+		"- Trains weights of rules of grammar with identifier <id> in Chomsky normal form on lines of file \"corpus\"\n\twith <n> iterations of inside-outside algorithm. Lines are split between threads." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "30. generate <id> length=<n> count=<k> \"file\" [seed=<s>] [threads=<n>] " << BRIGHT_BLACK_TEXT <<
+		"- Writes <k> random words of length <n> of grammar with identifier <id> in Chomsky normal form in \"file\".\n\tEvery parse tree is equally likely, so words are equally likely if the grammar is unambiguous.\n\tThe same seed gives the same words with any number of threads." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "31. enumerate <id> length=<n> \"file\" [threads=<n>] " << BRIGHT_BLACK_TEXT <<
+		"- Writes every word of length up to <n> of grammar with identifier <id> in Chomsky normal form\n\tin \"file\" in lexicographic order." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "32. cyk-batch <id> \"corpus\" \"results\" [threads=<n>] " << BRIGHT_BLACK_TEXT <<
+		"- Performs CYK algorithm over grammar with identifier <id> with every line of file \"corpus\"\n\tand writes 1 (recognized) or 0 (not recognized) per line in file \"results\"." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "33. copy <id> " << BRIGHT_BLACK_TEXT <<
+		"- Creates a new grammar - copy of grammar with identifier <id>." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "34. drop <id> " << BRIGHT_BLACK_TEXT <<
+		"- Deletes grammar with identifier <id> and frees the memory it does not share with other grammars.\n\tIds of other grammars do not change." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "35. mem " << BRIGHT_BLACK_TEXT <<
+		"- Shows how much memory the program uses and how many grammars are alive." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "36. flush " << BRIGHT_BLACK_TEXT <<
+		"- Writes out everything printed so far. Only needed in script mode, where output is buffered." << RESET_COLORING << '\n';
+	cout << BRIGHT_WHITE_TEXT << "\t" << "37. quit " << BRIGHT_BLACK_TEXT <<
+		"- Closes the program." << RESET_COLORING << '\n';
+#ifdef DISPATCH_BENCH
+	cout << BRIGHT_WHITE_TEXT << "\t" << "38. bench-dispatch <n> " << BRIGHT_BLACK_TEXT <<
+		"- Measures how long recognizing a command takes, with the command table and with the\n\tformer regular expressions, over <n> rounds of sample commands." << RESET_COLORING << '\n';
+#endif
+	cout << BRIGHT_YELLOW_TEXT << "Commands are case and space sensitive. A single difference from layout will result in unrecognized command." << '\n'
+		<< "Tip: Do not start commands with capital letter or put space after last expected character!" << RESET_COLORING << '\n';
+}
+
+System::~System() {}
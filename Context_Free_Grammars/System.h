@@ -1,34 +1,105 @@
 #pragma once
 #include <fstream>
 #include <iostream>
-#include <regex>
+#include <chrono>
+#include <sstream>
 #include "Grammar.h"
+#include "CommandParser.h"
+#include "ProcessMemory.h"
+#include "DispatchBench.h"
 
 using std::endl;
 using std::cout;
 using std::cin;
 using std::cerr;
-using std::regex;
-using std::sregex_iterator;
 
-const unsigned INITIAL_CAPACITY = 32;
-const unsigned RESIZE_FACTOR = 2;
+const unsigned PARALLEL_LOAD_GRAIN = 4096; //rule lines parsed by one task when a text grammar is opened
 
 class System {
 private:
-	Grammar* grammars;
-	unsigned capacity;
-	unsigned numberOfGrammars;
+	using CommandHandler = void (System::*)(const ParsedCommand& command);
+
+	vector<std::unique_ptr<Grammar> > grammars; //index is id of grammar, dropped grammars leave nullptr
+	vector<std::shared_ptr<const Composition> > compositions; //set instead of grammars[id] while result of union, concat or iter is lazy
+	CommandParser parser;
+	vector<CommandHandler> handlers; //handlers[i] runs command with index i in parser
+	bool running;
+	bool interactive; //prompt is only shown in interactive mode
+	bool jsonLines; //every command prints one JSON object with its output instead of plain output
+	unsigned commandsRun;
 
 	bool isExisitngIndex(unsigned inedx) const;
-	void resize();
 	void open(const string& fileName);
 	void save(unsigned id, const string& fileName);
-	unsigned addGrammar(const Grammar& gram);
+	void openBinary(const string& fileName);
+	void saveBinary(unsigned id, const string& fileName);
+	void cykBatch(unsigned id, const string& corpusFile, const string& resultsFile, unsigned threads);
+	void ambiguityBatch(unsigned id, const string& corpusFile, unsigned top, unsigned threads);
+	void train(unsigned id, const string& corpusFile, unsigned iterations, unsigned threads);
+	void generate(unsigned id, unsigned length, unsigned count, unsigned seed, const string& outputFile, unsigned threads);
+	void enumerate(unsigned id, unsigned maxLength, const string& outputFile, unsigned threads);
+	unsigned addGrammar(Grammar&& gram);
+	unsigned addComposition(std::shared_ptr<const Composition> node);
+	Grammar& grammar(unsigned id);
+	std::shared_ptr<const Composition> composition(unsigned id) const;
+	bool compose(Composition::Kind kind, const vector<unsigned>& ids, const string& operation, unsigned& newId);
+	void printRecognition(unsigned id, const string& word, bool recognized) const;
+	bool prepareComposition(unsigned id, Composition::Recognizer recognizer) const;
+
+	void addCommand(const string& keyword, const vector<ArgumentKind>& arguments, CommandHandler handler);
+	bool dispatch(const string& line);
+	void dispatchAsJson(const string& line);
+
+	void quitCommand(const ParsedCommand& command);
+	void openCommand(const ParsedCommand& command);
+	void saveCommand(const ParsedCommand& command);
+	void openBinaryCommand(const ParsedCommand& command);
+	void saveBinaryCommand(const ParsedCommand& command);
+	void listCommand(const ParsedCommand& command);
+	void printCommand(const ParsedCommand& command);
+	void addRuleCommand(const ParsedCommand& command);
+	void removeRuleCommand(const ParsedCommand& command);
+	void unionCommand(const ParsedCommand& command);
+	void concatCommand(const ParsedCommand& command);
+	void iterCommand(const ParsedCommand& command);
+	void unionAllCommand(const ParsedCommand& command);
+	void concatAllCommand(const ParsedCommand& command);
+	void chomskifyCommand(const ParsedCommand& command);
+	void chomskyCommand(const ParsedCommand& command);
+	void emptyCommand(const ParsedCommand& command);
+	void reduceCommand(const ParsedCommand& command);
+	void CYKCommand(const ParsedCommand& command);
+	void CYKWordsCommand(const ParsedCommand& command);
+	void CYKPrefixesCommand(const ParsedCommand& command);
+	void earleyCommand(const ParsedCommand& command);
+	void parseCommand(const ParsedCommand& command);
+	void parseTreesCommand(const ParsedCommand& command);
+	void parseForestCommand(const ParsedCommand& command);
+	void ambiguityCommand(const ParsedCommand& command);
+	void ambiguityExactCommand(const ParsedCommand& command);
+	void ambiguityBatchCommand(const ParsedCommand& command);
+	void viterbiCommand(const ParsedCommand& command);
+	void trainCommand(const ParsedCommand& command);
+	void generateCommand(const ParsedCommand& command);
+	void enumerateCommand(const ParsedCommand& command);
+	void CYKBatchCommand(const ParsedCommand& command);
+	void copyCommand(const ParsedCommand& command);
+	void dropCommand(const ParsedCommand& command);
+	void memCommand(const ParsedCommand& command);
+#ifdef DISPATCH_BENCH
+	void benchDispatchCommand(const ParsedCommand& command);
+#endif
+	void flushCommand(const ParsedCommand& command);
+	void commandsCommand(const ParsedCommand& command);
 public:
 	System();
+	System(const System& other) = delete;
+	System& operator = (const System& other) = delete;
 	
-	void opreate();
+	//Script mode: no prompt and, if jsonLines is set, machine-readable output. Colours are turned off separately.
+	void setBatchMode(bool jsonLines);
+	//Runs commands from in until 'quit' or end of input
+	void opreate(std::istream& in = cin);
 
 	~System();
 };
\ No newline at end of file
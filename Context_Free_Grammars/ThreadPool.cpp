@@ -0,0 +1,110 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned workers) : generation(0), stopping(false), task(nullptr), pending(0) {
+	if (workers == 0)
+		workers = 1;
+	for (unsigned i = 0; i < workers; i++) {
+		queues.emplace_back(new WorkQueue);
+	}
+	for (unsigned i = 0; i + 1 < workers; i++) {
+		threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(stateLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& t : threads) {
+		t.join();
+	}
+}
+
+unsigned ThreadPool::hardwareWorkers() {
+	unsigned count = std::thread::hardware_concurrency();
+	return count == 0 ? 1 : count;
+}
+
+//Own queue is used from the front, other queues are robbed from the back
+bool ThreadPool::takeRange(unsigned self, Range& range) {
+	{
+		WorkQueue& own = *queues[self];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.ranges.empty()) {
+			range = own.ranges.front();
+			own.ranges.pop_front();
+			return true;
+		}
+	}
+	for (unsigned offset = 1; offset < queues.size(); offset++) {
+		WorkQueue& victim = *queues[(self + offset) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.ranges.empty()) {
+			range = victim.ranges.back();
+			victim.ranges.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::runAvailable(unsigned self) {
+	Range range;
+	while (takeRange(self, range)) {
+		(*task)(range.begin, range.end);
+		if (--pending == 0) {
+			std::lock_guard<std::mutex> guard(stateLock);
+			finished.notify_all();
+		}
+	}
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+	unsigned long long seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(stateLock);
+			wake.wait(guard, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+		}
+		runAvailable(self);
+	}
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& task) {
+	if (begin >= end)
+		return;
+	if (grain == 0)
+		grain = 1;
+	if (threads.empty() || end - begin <= grain) {
+		task(begin, end);
+		return;
+	}
+	size_t chunks = (end - begin + grain - 1) / grain;
+	this->task = &task;
+	pending = chunks;
+
+	//Every participant gets a contiguous block of chunks so neighbouring indices stay on one thread unless they are stolen
+	size_t perQueue = (chunks + queues.size() - 1) / queues.size();
+	for (size_t c = 0; c < chunks; c++) {
+		size_t chunkBegin = begin + c * grain;
+		size_t chunkEnd = chunkBegin + grain < end ? chunkBegin + grain : end;
+		WorkQueue& queue = *queues[c / perQueue];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.ranges.push_back({ chunkBegin, chunkEnd });
+	}
+	{
+		std::lock_guard<std::mutex> guard(stateLock);
+		generation++;
+	}
+	wake.notify_all();
+
+	runAvailable(static_cast<unsigned>(threads.size()));
+
+	std::unique_lock<std::mutex> guard(stateLock);
+	finished.wait(guard, [&] { return pending == 0; });
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed set of worker threads running index ranges.
+//Every participant (the workers and the thread calling parallelFor) owns a queue of chunks. It takes chunks from the front of
+//its own queue and, once that is empty, steals from the back of the others. parallelFor returns only when every chunk is done,
+//so consecutive calls are separated by a barrier.
+class ThreadPool {
+private:
+	struct Range {
+		size_t begin;
+		size_t end;
+	};
+	struct WorkQueue {
+		std::mutex lock;
+		std::deque<Range> ranges;
+	};
+
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<WorkQueue> > queues; //queues[threads.size()] belongs to the caller of parallelFor
+	std::mutex stateLock;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	unsigned long long generation;
+	bool stopping;
+	const std::function<void(size_t, size_t)>* task;
+	std::atomic<size_t> pending; //chunks of current parallelFor which are not finished yet
+
+	bool takeRange(unsigned self, Range& range);
+	void runAvailable(unsigned self);
+	void workerLoop(unsigned self);
+public:
+	//workers includes the calling thread, so ThreadPool(1) starts no threads and runs everything serially
+	explicit ThreadPool(unsigned workers);
+	ThreadPool(const ThreadPool& other) = delete;
+	ThreadPool& operator = (const ThreadPool& other) = delete;
+	~ThreadPool();
+
+	unsigned size() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+	//Calls task(chunkBegin, chunkEnd) over [begin, end) split in chunks of at most grain indices
+	void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& task);
+
+	static unsigned hardwareWorkers();
+};
@@ -0,0 +1,117 @@
+#include "ViterbiParser.h"
+#include <algorithm>
+#include <limits>
+#include <ostream>
+
+static const float NO_PARSE = -std::numeric_limits<float>::infinity();
+
+//Same loop order as DerivationCounts with (max, +) in place of (+, *). Non-terminals present in a cell are listed, so a split
+//only looks at pairs of rules whose first symbol derives the left part.
+ViterbiParser::ViterbiParser(const RuleStore& rules, const CompiledGrammar& index, const std::string& word, unsigned beam)
+	: parsedWord(word), n(static_cast<unsigned>(word.length())), ntCount(index.nonTerminalCount()), start(index.startingSymbol()),
+	scores(), back(), emptyWord({ NO_RULE, 0 }), emptyWordScore(NO_PARSE) {
+	if (n == 0) {
+		if (start >= ntCount)
+			return;
+		for (const unsigned* r = index.rulesOfBegin(start); r != index.rulesOfEnd(start); r++) {
+			if (rules[*r].product.size() == 1 && rules[*r].product[0] == EPSILON_SYMBOL && index.logWeight(*r) > emptyWordScore) {
+				emptyWordScore = index.logWeight(*r);
+				emptyWord = { *r, 0 };
+			}
+		}
+		return;
+	}
+	scores.assign(cellCount() * ntCount, NO_PARSE);
+	back.resize(scores.size());
+	std::vector<std::vector<symbol> > present(cellCount());	//present[cell] = {A | scores of A in cell > -infinity}
+	for (unsigned i = 0; i < n; i++) {
+		const size_t cell = cellIndex(i, 1);
+		const symbol* head = index.terminalHeadsBegin(word[i]);
+		for (const unsigned* r = index.terminalRulesBegin(word[i]); r != index.terminalRulesEnd(word[i]); r++, head++) {
+			if (index.logWeight(*r) == NO_PARSE)
+				continue;
+			scores[cell * ntCount + *head] = index.logWeight(*r); //rules are unique, so A->c is the only way
+			back[cell * ntCount + *head] = { *r, 0 };
+			present[cell].push_back(*head);
+		}
+		if (n > 1)
+			prune(cell, present[cell], beam);
+	}
+	for (unsigned len = 2; len <= n; len++) {
+		for (unsigned i = 0; i + len <= n; i++) {
+			const size_t cell = cellIndex(i, len);
+			float* cellScores = &scores[cell * ntCount];
+			BackPointer* cellBack = &back[cell * ntCount];
+			std::vector<symbol>& heads = present[cell];
+			for (unsigned k = 1; k < len; k++) {
+				const size_t left = cellIndex(i, k);
+				const float* rightScores = &scores[cellIndex(i + k, len - k) * ntCount];
+				for (symbol first : present[left]) {
+					const float leftScore = scores[left * ntCount + first];
+					for (const CompiledGrammar::BinaryRule* rule = index.pairsOfBegin(first); rule != index.pairsOfEnd(first); rule++) {
+						//-infinity of a missing right child stays -infinity, so one rarely taken comparison covers both cases.
+						//Testing the right child first costs a mispredicted branch whenever beam leaves gaps in the cell.
+						const float score = leftScore + rightScores[rule->second] + index.logWeight(rule->rule);
+						if (!(score > cellScores[rule->head]))
+							continue;
+						if (cellScores[rule->head] == NO_PARSE)
+							heads.push_back(rule->head);
+						cellScores[rule->head] = score;
+						cellBack[rule->head] = { rule->rule, k };
+					}
+				}
+			}
+			if (len < n)
+				prune(cell, heads, beam);
+		}
+	}
+}
+
+//Keeps only the 'beam' best non-terminals of cell. Pruned ones get -infinity, so longer spans do not build on them.
+//Cell of the whole word is never pruned - it would only lose the starting symbol. Kept ones are sorted, so longer spans
+//go over pairs of rules in memory order.
+void ViterbiParser::prune(size_t cell, std::vector<symbol>& heads, unsigned beam) {
+	if (beam == 0 || heads.size() <= beam)
+		return;
+	float* cellScores = &scores[cell * ntCount];
+	std::nth_element(heads.begin(), heads.begin() + beam, heads.end(), [cellScores](symbol a, symbol b) { return cellScores[a] > cellScores[b]; });
+	for (auto it = heads.begin() + beam; it != heads.end(); it++)
+		cellScores[*it] = NO_PARSE;
+	heads.resize(beam);
+	std::sort(heads.begin(), heads.end());
+}
+
+bool ViterbiParser::recognized() const {
+	return logWeight() != NO_PARSE;
+}
+
+float ViterbiParser::logWeight() const {
+	if (n == 0)
+		return emptyWordScore;
+	if (start >= ntCount)
+		return NO_PARSE;
+	return scores[cellIndex(0, n) * ntCount + start];
+}
+
+void ViterbiParser::writeTree(std::ostream& os, const RuleStore& rules, const std::function<std::string(symbol)>& name) const {
+	if (!recognized())
+		return;
+	if (n == 0)
+		os << name(start) << "(@)";
+	else
+		writeTree(os, rules, start, 0, n, name);
+}
+
+void ViterbiParser::writeTree(std::ostream& os, const RuleStore& rules, symbol nt, unsigned i, unsigned len, const std::function<std::string(symbol)>& name) const {
+	const BackPointer& way = back[cellIndex(i, len) * ntCount + nt];
+	os << name(nt) << '(';
+	if (way.split == 0) {
+		os << parsedWord[i] << ')';
+		return;
+	}
+	const std::vector<symbol>& product = rules[way.rule].product;
+	writeTree(os, rules, product[0], i, way.split, name);
+	os << ' ';
+	writeTree(os, rules, product[1], i + way.split, len - way.split, name);
+	os << ')';
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "BitKernel.h"
+#include "CompiledGrammar.h"
+#include "ProducitonRule.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+//Most probable parse tree of one word in a weighted grammar in Chomsky normal form. Weight of a tree is product of weights of
+//its rules; the chart keeps, for every span and non-terminal, the best log-weight and a back-pointer (rule, split) to the
+//children it came from. Both are dense arrays indexed by (cell, non-terminal), so the inner loop does no allocation.
+//With beam > 0 only the 'beam' best non-terminals of every cell are kept, which makes long words fast but may miss the best tree.
+class ViterbiParser {
+public:
+	struct BackPointer {
+		unsigned rule;
+		unsigned split;	//letters derived by the first child, 0 for A->c and A->@
+	};
+	static const unsigned NO_RULE = 0xFFFFFFFFu;
+private:
+	std::string parsedWord;
+	unsigned n;
+	unsigned ntCount;
+	symbol start;
+	std::vector<float> scores;			//scores[cellIndex(i, len) * ntCount + A], -infinity if A does not derive the span
+	std::vector<BackPointer> back;		//same layout as scores
+	BackPointer emptyWord;				//best S->@ for the empty word
+	float emptyWordScore;
+
+	//Span of len letters (1..n) starting at i, see spanCell
+	size_t cellIndex(unsigned i, unsigned len) const { return spanCell(n, i, len); }
+	size_t cellCount() const { return spanCellCount(n); }
+	void prune(size_t cell, std::vector<symbol>& heads, unsigned beam);
+	void writeTree(std::ostream& os, const RuleStore& rules, symbol nt, unsigned i, unsigned len, const std::function<std::string(symbol)>& name) const;
+public:
+	//Grammar has to be in Chomsky normal form (index.isChomsky()). beam = 0 keeps every non-terminal.
+	ViterbiParser(const RuleStore& rules, const CompiledGrammar& index, const std::string& word, unsigned beam);
+
+	bool recognized() const;
+	//Natural logarithm of weight of the best tree, -infinity if there is none
+	float logWeight() const;
+	//Writes best tree in bracketed form, i.e. S(A(a) B(b)). rules have to be the ones the parser was built from.
+	void writeTree(std::ostream& os, const RuleStore& rules, const std::function<std::string(symbol)>& name) const;
+};
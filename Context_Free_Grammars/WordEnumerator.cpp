@@ -0,0 +1,127 @@
+#include "WordEnumerator.h"
+#include <algorithm>
+
+WordEnumerator::WordEnumerator(const CYKRecognizer& recognizer, const CompiledGrammar& index, unsigned maxLength)
+	: recognizer(recognizer), maxLength(maxLength), words(recognizer.cellWords()), letters(), wildcards() {
+	for (unsigned c = 0; c < 256; c++) {
+		if (c != '@' && index.terminalHeadsBegin(static_cast<char>(c)) != index.terminalHeadsEnd(static_cast<char>(c)))
+			letters += static_cast<char>(c);
+	}
+	wildcards.assign((maxLength + 1) * static_cast<size_t>(words), 0);
+	if (maxLength == 0)
+		return;
+	for (char c : letters)
+		orInto(&wildcards[words], recognizer.letterHeads(c), words);
+	for (unsigned len = 2; len <= maxLength; len++) {
+		for (unsigned k = 1; k < len; k++)
+			recognizer.combine(&wildcards[len * static_cast<size_t>(words)], &wildcards[k * static_cast<size_t>(words)],
+				&wildcards[(len - k) * static_cast<size_t>(words)]);
+	}
+}
+
+bitWord* WordEnumerator::fixedCell(Walk& walk, unsigned i, unsigned j) const {
+	return &walk.fixed[(static_cast<size_t>(j) * (j - 1) / 2 + i) * words];
+}
+
+const bitWord* WordEnumerator::fixedCell(const Walk& walk, unsigned i, unsigned j) const {
+	return &walk.fixed[(static_cast<size_t>(j) * (j - 1) / 2 + i) * words];
+}
+
+bool WordEnumerator::accepted(const Walk& walk) const {
+	if (walk.prefix.empty())
+		return recognizer.emptyWordAccepted();
+	return recognizer.hasStart(fixedCell(walk, 0, static_cast<unsigned>(walk.prefix.size())));
+}
+
+//Fills cells (i, j) with i <= d < j from the shortest up. Left part (i, k) is a plain cell if k <= d and a shorter layer
+//cell otherwise; right part (k, j) is a shorter layer cell if k <= d and lies after the prefix otherwise.
+bool WordEnumerator::extend(Walk& walk, char c) const {
+	const unsigned d = static_cast<unsigned>(walk.prefix.size());
+	const unsigned width = maxLength - d;	//j in d + 1..maxLength
+	auto layerCell = [&](unsigned i, unsigned j) { return &walk.layer[(static_cast<size_t>(i) * width + (j - d - 1)) * words]; };
+	walk.layer.assign(static_cast<size_t>(d + 1) * width * words, 0);
+	for (unsigned len = 1; len <= maxLength; len++) {
+		for (unsigned i = d + 1 > len ? d + 1 - len : 0; i <= d && i + len <= maxLength; i++) {
+			const unsigned j = i + len;
+			bitWord* target = layerCell(i, j);
+			if (len == 1) {
+				orInto(target, recognizer.letterHeads(c), words);
+				continue;
+			}
+			for (unsigned k = i + 1; k < j; k++) {
+				const bitWord* left = k <= d ? fixedCell(walk, i, k) : layerCell(i, k);
+				const bitWord* right = k <= d ? layerCell(k, j) : &wildcards[(j - k) * static_cast<size_t>(words)];
+				recognizer.combine(target, left, right);
+			}
+		}
+	}
+	walk.prefix += c;
+	walk.fixed.resize(static_cast<size_t>(d + 1) * (d + 2) / 2 * words);
+	for (unsigned i = 0; i <= d; i++)
+		std::copy(layerCell(i, d + 1), layerCell(i, d + 1) + words, fixedCell(walk, i, d + 1));
+	for (unsigned j = d + 1; j <= maxLength; j++) {
+		if (recognizer.hasStart(layerCell(0, j)))
+			return true;
+	}
+	return false;
+}
+
+void WordEnumerator::retreat(Walk& walk) const {
+	walk.prefix.pop_back();
+	const size_t d = walk.prefix.size();
+	walk.fixed.resize(d * (d + 1) / 2 * words);
+}
+
+//Iterative, so long words do not use up the call stack. next.back() is the index of the next letter to try after the
+//current prefix, and every other entry belongs to one of its shorter prefixes.
+void WordEnumerator::search(Walk& walk, unsigned limit, const std::function<void(const std::string&, bool)>& found) const {
+	if (walk.prefix.size() == limit) { //a prefix of length maxLength starts a word only if it is one
+		if (limit < maxLength || accepted(walk))
+			found(walk.prefix, true);
+		return;
+	}
+	if (accepted(walk))
+		found(walk.prefix, false);
+	std::vector<unsigned> next(1, 0);
+	while (!next.empty()) {
+		if (next.back() == letters.size()) {
+			next.pop_back();
+			if (!next.empty())
+				retreat(walk);
+			continue;
+		}
+		if (!extend(walk, letters[next.back()++])) {
+			retreat(walk);
+			continue;
+		}
+		if (walk.prefix.size() == limit) {
+			found(walk.prefix, true);
+			retreat(walk);
+			continue;
+		}
+		if (accepted(walk))
+			found(walk.prefix, false);
+		next.push_back(0);
+	}
+}
+
+std::vector<WordEnumerator::Item> WordEnumerator::split(unsigned depth) const {
+	std::vector<Item> items;
+	Walk walk;
+	search(walk, std::min(depth, maxLength), [&](const std::string& text, bool prefix) { items.push_back({ text, prefix }); });
+	return items;
+}
+
+//Words of length maxLength are the prefixes of length maxLength which start some word
+size_t WordEnumerator::listWords(const std::string& prefix, std::string& out) const {
+	Walk walk;
+	for (char c : prefix)
+		extend(walk, c);
+	size_t listed = 0;
+	search(walk, maxLength, [&](const std::string& word, bool) {
+		out += word;
+		out += '\n';
+		listed++;
+	});
+	return listed;
+}
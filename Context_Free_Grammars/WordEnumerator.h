@@ -0,0 +1,54 @@
+#pragma once
+#include "CYKRecognizer.h"
+#include "CompiledGrammar.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+//Every word of length up to maxLength of a grammar in Chomsky normal form, in lexicographic order.
+//Words are found by depth-first search over prefixes which tries letters in increasing order and goes into a prefix only if
+//some word of length up to maxLength starts with it, so no branch of the search is wasted. That is decided with a CYK chart
+//in which every position after the prefix is a wildcard matching any letter: cell (i, j) holds every A which derives
+//prefix[i, min(j, d)) followed by j - max(i, d) letters, where d is the length of the prefix. Cells lying fully after the
+//prefix only depend on their length and are computed once. When a letter is added at position d, only cells (i, j) with
+//i <= d < j change; those with j = d + 1 are plain CYK cells of the prefix and are kept while the prefix is extended.
+class WordEnumerator {
+public:
+	//Part of the output: a word, or a prefix all of whose words are still to be listed
+	struct Item {
+		std::string text;
+		bool prefix;
+	};
+private:
+	//State of one search
+	struct Walk {
+		std::string prefix;
+		std::vector<bitWord> fixed;		//cells (i, d) for 0 <= i < d <= prefix length, column d starts at cells d * (d - 1) / 2
+		std::vector<bitWord> layer;		//cells (i, j) with i < prefix length <= j of the last extension
+	};
+	const CYKRecognizer& recognizer;
+	unsigned maxLength;
+	unsigned words;						//64-bit words per cell
+	std::string letters;				//every terminal in increasing order
+	std::vector<bitWord> wildcards;		//wildcards[len * words] = {A | A derives some word of length len}, len in 1..maxLength
+
+	bitWord* fixedCell(Walk& walk, unsigned i, unsigned j) const;
+	const bitWord* fixedCell(const Walk& walk, unsigned i, unsigned j) const;
+	bool accepted(const Walk& walk) const;
+	//Adds c to prefix and returns whether some word of length up to maxLength starts with the new prefix
+	bool extend(Walk& walk, char c) const;
+	void retreat(Walk& walk) const;
+	//Searches below walk.prefix down to prefixes of length limit. Calls found(word, false) for every word shorter than limit
+	//and found(prefix, true) for every prefix of length limit which starts some word, both in lexicographic order.
+	void search(Walk& walk, unsigned limit, const std::function<void(const std::string&, bool)>& found) const;
+public:
+	//recognizer and index have to belong to the same grammar, which has to be in Chomsky normal form
+	WordEnumerator(const CYKRecognizer& recognizer, const CompiledGrammar& index, unsigned maxLength);
+
+	//Words shorter than depth and prefixes of length depth which start some word, in lexicographic order. Words of
+	//different prefixes are independent, so they can be listed in parallel and written in the order of the items.
+	std::vector<Item> split(unsigned depth) const;
+	//Appends every word starting with prefix, prefix included, to out in lexicographic order, one per line.
+	//prefix has to come from split. Returns number of words.
+	size_t listWords(const std::string& prefix, std::string& out) const;
+};
@@ -0,0 +1,182 @@
+#include "WordSampler.h"
+#include <cassert>
+#include <cmath>
+#include <map>
+
+WordSampler::WordSampler(const RuleStore& rules, const CompiledGrammar& index, unsigned length, ThreadPool& pool)
+	: length(length), ntCount(index.nonTerminalCount()), start(index.startingSymbol()), binaryOf(ntCount), lettersOf(ntCount),
+	pairs(), counts(), mantissas(), exponents(), lengthsOf(ntCount), total() {
+	std::map<std::pair<symbol, symbol>, size_t> pairAt;
+	for (symbol nt = 0; nt < ntCount; nt++) {
+		for (const unsigned* r = index.rulesOfBegin(nt); r != index.rulesOfEnd(nt); r++) {
+			const std::vector<symbol>& product = rules[*r].product;
+			if (product.size() == 2) {
+				binaryOf[nt].push_back({ product[0], product[1] });
+				auto found = pairAt.emplace(std::make_pair(product[0], product[1]), pairs.size());
+				if (found.second)
+					pairs.push_back({ product[0], product[1], {} });
+				pairs[found.first->second].heads.push_back(nt);
+			}
+			else if (product[0] != EPSILON_SYMBOL) {
+				lettersOf[nt] += terminalOf(product[0]);
+			}
+		}
+	}
+	if (start >= ntCount)
+		return;
+	if (length == 0) {
+		for (const unsigned* r = index.rulesOfBegin(start); r != index.rulesOfEnd(start); r++) {
+			if (rules[*r].product[0] == EPSILON_SYMBOL)
+				total = 1;
+		}
+		return;
+	}
+
+	counts.resize(at(length + 1, 0));
+	for (symbol nt = 0; nt < ntCount; nt++)
+		counts[at(1, nt)] = lettersOf[nt].size();
+	//Trees of A->BC and A'->BC over the same span are counted once for BC
+	std::vector<BigCount> pairCounts(pairs.size());
+	for (unsigned len = 2; len <= length; len++) {
+		pool.parallelFor(0, pairs.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t p = begin; p < end; p++) {
+				pairCounts[p] = BigCount();
+				for (unsigned k = 1; k < len; k++) {
+					const BigCount& left = counts[at(k, pairs[p].first)];
+					const BigCount& right = counts[at(len - k, pairs[p].second)];
+					if (!left.isZero() && !right.isZero())
+						pairCounts[p] += left * right;
+				}
+			}
+		});
+		for (size_t p = 0; p < pairs.size(); p++) {
+			for (symbol head : pairs[p].heads)
+				counts[at(len, head)] += pairCounts[p];
+		}
+	}
+	mantissas.resize(counts.size());
+	exponents.resize(counts.size());
+	for (size_t i = 0; i < counts.size(); i++)
+		mantissas[i] = counts[i].approximate(exponents[i]);
+	for (unsigned len = 1; len <= length; len++) {
+		for (symbol nt = 0; nt < ntCount; nt++) {
+			if (!counts[at(len, nt)].isZero())
+				lengthsOf[nt].push_back(len);
+		}
+	}
+	total = counts[at(length, start)];
+}
+
+//Exact choice: rest in [0, counts[len][nt]) falls into the part of one (rule, split) of the running sum of their trees
+void WordSampler::pickExactly(symbol nt, unsigned len, BigCount rest, symbol& first, symbol& second, unsigned& split) const {
+	for (const std::pair<symbol, symbol>& rule : binaryOf[nt]) {
+		for (unsigned k : lengthsOf[rule.first]) {
+			if (k >= len)
+				break;
+			const BigCount& right = counts[at(len - k, rule.second)];
+			if (right.isZero())
+				continue;
+			BigCount trees = counts[at(k, rule.first)] * right;
+			if (rest < trees) {
+				first = rule.first;
+				second = rule.second;
+				split = k;
+				return;
+			}
+			rest -= trees;
+		}
+	}
+}
+
+//Same choice as pickExactly for a number whose ratio to counts[len][nt] lies in [position, position + 2^-63], with the
+//running sum kept in doubles relative to counts[len][nt], so no big multiplication is needed. Returns false if the number
+//lies so close to a boundary between two parts that rounding could pick the wrong one.
+bool WordSampler::pickApproximately(symbol nt, unsigned len, double position, symbol& first, symbol& second, unsigned& split) const {
+	const size_t whole = at(len, nt);
+	double below = 0.0;
+	unsigned parts = 0;
+	for (const std::pair<symbol, symbol>& rule : binaryOf[nt]) {
+		for (unsigned k : lengthsOf[rule.first]) { //splits where the first child derives nothing have no trees
+			if (k >= len)
+				break;
+			const size_t left = at(k, rule.first), right = at(len - k, rule.second);
+			if (mantissas[right] == 0.0)
+				continue;
+			parts++;
+			const double above = below + std::ldexp(mantissas[left] * mantissas[right] / mantissas[whole],
+				exponents[left] + exponents[right] - exponents[whole]);
+			if (position < above) {
+				const double margin = 1e-14 * (parts + 1); //far above rounding errors of parts additions
+				if ((parts > 1 && position - below <= margin) || above - position <= margin) //sum before the first part is exactly 0
+					return false;
+				first = rule.first;
+				second = rule.second;
+				split = k;
+				return true;
+			}
+			below = above;
+		}
+	}
+	return false;
+}
+
+//Draws a number in [0, counts[len][nt]) uniformly, but only its top 64 bits unless the choice needs all of them - they are
+//as long as the count. Number is high * 2^shift + low with low in [0, 2^shift). Drawing high in [0, top] and rejecting
+//numbers from counts[len][nt] up keeps it uniform; rejection needs high = top, which has probability below 2^-63.
+void WordSampler::pickSplit(symbol nt, unsigned len, Engine& engine, symbol& first, symbol& second, unsigned& split) const {
+	const size_t whole = at(len, nt);
+	const BigCount& trees = counts[whole];
+	const unsigned shift = trees.bitLength() > 64 ? trees.bitLength() - 64 : 0;
+	const std::uint64_t top = trees.bitsAbove(shift);
+	std::uint64_t high;
+	BigCount drawn;
+	bool complete = shift == 0;		//whether drawn holds the whole number
+	while (true) {
+		high = std::uniform_int_distribution<std::uint64_t>(0, shift == 0 ? top - 1 : top)(engine);
+		if (complete || high < top)
+			break;
+		drawn = BigCount(high);
+		drawn <<= shift;
+		drawn += BigCount::randomBits(shift, engine);
+		if (drawn < trees) {
+			complete = true;
+			break;
+		}
+	}
+	const double position = std::ldexp(static_cast<double>(high) / mantissas[whole], static_cast<int>(shift) - exponents[whole]);
+	if (pickApproximately(nt, len, position, first, second, split))
+		return;
+	if (shift == 0) {
+		drawn = BigCount(high);
+	}
+	else if (!complete) {
+		drawn = BigCount(high);
+		drawn <<= shift;
+		drawn += BigCount::randomBits(shift, engine);
+	}
+	pickExactly(nt, len, drawn, first, second, split);
+}
+
+//Children are expanded leftmost first, so letters come out in order
+void WordSampler::sample(Engine& engine, std::string& out, Stack& stack) const {
+	assert(!total.isZero());
+	stack.clear();
+	if (length != 0)
+		stack.push_back({ start, length });
+	while (!stack.empty()) {
+		const symbol nt = stack.back().first;
+		const unsigned len = stack.back().second;
+		stack.pop_back();
+		if (len == 1) {
+			const std::string& letters = lettersOf[nt];
+			out += letters[std::uniform_int_distribution<size_t>(0, letters.size() - 1)(engine)];
+			continue;
+		}
+		symbol first, second;
+		unsigned split;
+		pickSplit(nt, len, engine, first, second, split);
+		stack.push_back({ second, len - split });
+		stack.push_back({ first, split });
+	}
+	out += '\n';
+}
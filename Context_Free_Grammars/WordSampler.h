@@ -0,0 +1,51 @@
+#pragma once
+#include "BigCount.h"
+#include "CompiledGrammar.h"
+#include "ProducitonRule.h"
+#include "ThreadPool.h"
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Uniformly random parse trees of words of one length in a grammar in Chomsky normal form, drawn without rejection.
+//counts[len][A] is the exact number of parse trees of words of length len derived by A. A tree of (A, len) is drawn by
+//picking rule A->BC and split k with probability counts[k][B] * counts[len - k][C] / counts[len][A] and drawing both
+//children the same way. Every tree is equally likely, so words are uniform exactly when the grammar is unambiguous -
+//an ambiguous word is drawn as often as it has trees.
+class WordSampler {
+public:
+	using Engine = std::mt19937_64;
+	using Stack = std::vector<std::pair<symbol, unsigned> >;	//(non-terminal, length) still to be expanded
+private:
+	struct Pair {
+		symbol first;
+		symbol second;
+		std::vector<symbol> heads;	//every A with A->first second
+	};
+	unsigned length;
+	unsigned ntCount;
+	symbol start;
+	std::vector<std::vector<std::pair<symbol, symbol> > > binaryOf;	//binaryOf[A] = {(B, C) | A->BC}
+	std::vector<std::string> lettersOf;		//lettersOf[A] = {c | A->c}
+	std::vector<Pair> pairs;				//distinct right sides BC
+	std::vector<BigCount> counts;			//counts[len * ntCount + A], len in 1..length
+	std::vector<double> mantissas;			//counts approximately, see BigCount::approximate
+	std::vector<int> exponents;
+	std::vector<std::vector<unsigned> > lengthsOf;	//lengthsOf[A] = {len | counts[len][A] > 0} in increasing order
+	BigCount total;							//trees of the starting symbol of words of the length
+
+	size_t at(unsigned len, symbol nt) const { return static_cast<size_t>(len) * ntCount + nt; }
+	//Picks (B, C) and split of a tree of (nt, len) with len >= 2
+	void pickSplit(symbol nt, unsigned len, Engine& engine, symbol& first, symbol& second, unsigned& split) const;
+	bool pickApproximately(symbol nt, unsigned len, double position, symbol& first, symbol& second, unsigned& split) const;
+	void pickExactly(symbol nt, unsigned len, BigCount rest, symbol& first, symbol& second, unsigned& split) const;
+public:
+	//Counts trees of every non-terminal for lengths up to length, spreading the right sides of every length over pool
+	WordSampler(const RuleStore& rules, const CompiledGrammar& index, unsigned length, ThreadPool& pool);
+
+	//Number of parse trees of words of the length, 0 if there is no such word
+	const BigCount& treeCount() const { return total; }
+	//Appends a random word of the length and '\n' to out. treeCount() must not be 0. stack is a reusable buffer.
+	void sample(Engine& engine, std::string& out, Stack& stack) const;
+};